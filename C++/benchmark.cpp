@@ -0,0 +1,1305 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "toml.h"
+
+// ============================================================================
+// Helpers
+
+// Seconds elapsed since the given start time
+double seconds_since(const std::chrono::steady_clock::time_point& start) {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// ----------------------------------------------------------------------------
+
+// Write the given contents to a file
+void write_file(const std::string filename, const std::string contents) {
+    std::ofstream fout(filename);
+    fout << contents;
+}
+
+// ----------------------------------------------------------------------------
+
+// Build a config that looks like eta000.toml, repeated with numbered table
+// names until it is at least the requested number of bytes
+std::string make_config(const std::size_t bytes) {
+    std::ostringstream ss;
+    for (unsigned n = 0; ss.tellp() < static_cast<long>(bytes); n++) {
+        ss << "# Parameters for the magnetic field ----------------------\n"
+            << "[field" << n << "]\n"
+            << "\n"
+            << "# Fraction of magnetic energy in the turbulent field\n"
+            << "turb_ener_frac = 0.0\n"
+            << "spectral_index = 1.666666666666666\n"
+            << "max_wave = 10.0\n"
+            << "min_wave = 0.1\n"
+            << "wave_resolution = 50\n"
+            << "wave_speed = 1.0e-3\n"
+            << "\n"
+            << "# Parameters for the experiment -------------------------\n"
+            << "[ experiment" << n << " ]\n"
+            << "\n"
+            << "name = \"eta_0.00\"\n"
+            << "notes = \"notes\"\n"
+            << "max_time = 2e4\n"
+            << "number_of_particles = 10\n"
+            << "particle_seed = 1\n"
+            << "experiment_directory = \"eta_000\"\n"
+            << "step_small = 1.0e-3\n"
+            << "max_steps = 100000\n"
+            << "\n";
+    }
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------------
+
+// The number reader that Value used before it was correctly rounded (summing
+// shifted digits and scaling by std::pow), kept as a baseline
+double summing_parse_number(const char*& it, const char* end) {
+    double sign = 1;
+    if (it != end && (*it == '-' || *it == '+')) {
+        sign = (*it == '-') ? -1 : 1;
+        it++;
+    }
+    int64_t ipart = 0;
+    while (it != end && *it >= '0' && *it <= '9') {
+        ipart = 10 * ipart + (*it - '0');
+        it++;
+    }
+    double dpart = 0;
+    double shift = 0.1;
+    if (it != end && *it == '.') {
+        it++;
+        while (it != end && *it >= '0' && *it <= '9') {
+            dpart += shift * (*it - '0');
+            shift *= 0.1;
+            it++;
+        }
+    }
+    int exponent = 0;
+    if (it != end && (*it == 'e' || *it == 'E')) {
+        it++;
+        int e_sign = 1;
+        if (*it == '-' || *it == '+') {
+            e_sign = (*it == '-') ? -1 : 1;
+            it++;
+        }
+        while (it != end && *it >= '0' && *it <= '9') {
+            exponent = 10 * exponent + (*it - '0');
+            it++;
+        }
+        exponent *= e_sign;
+    }
+    return sign * (static_cast<double>(ipart) + dpart) *
+        std::pow(10.0, exponent);
+}
+
+// ============================================================================
+// Benchmarks
+
+// Compare parse_file (memory-mapped) against parse_stream (std::getline)
+void benchmark_parse_file() {
+    const std::string filename = "benchmark_input.toml";
+    const std::string contents = make_config(256 << 10);
+    write_file(filename, contents);
+    const unsigned repeats = 20;
+    TOML::Table table;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        std::ifstream fin(filename);
+        table.parse_stream(fin);
+    }
+    double getline_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        table.parse_file(filename);
+    }
+    double mapped_time = seconds_since(start);
+
+    double megabytes = repeats * contents.size() / 1.0e6;
+    std::cout << "parse_file on " << contents.size() << " bytes:" << std::endl;
+    std::cout << "    getline stream : " << megabytes / getline_time
+        << " MB/s" << std::endl;
+    std::cout << "    memory-mapped  : " << megabytes / mapped_time
+        << " MB/s" << std::endl;
+
+    std::remove(filename.c_str());
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse and throw away a small config many times, on the heap and in an Arena
+void benchmark_arena() {
+    const std::string contents = make_config(1500);
+    const unsigned repeats = 20000;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::Table table;
+        table.parse_string(contents);
+    }
+    double heap_time = seconds_since(start);
+
+    TOML::Arena arena;
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        {
+            TOML::Table table(arena);
+            table.parse_string(contents);
+        }
+        arena.reset();
+    }
+    double arena_time = seconds_since(start);
+
+    std::cout << "parse and discard a " << contents.size() << " byte config:"
+        << std::endl;
+    std::cout << "    heap  : " << repeats / heap_time << " configs/s"
+        << std::endl;
+    std::cout << "    arena : " << repeats / arena_time << " configs/s"
+        << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a wide config eagerly and lazily, then read one key in ten
+void benchmark_lazy() {
+    std::ostringstream ss;
+    ss << "[wide]\n";
+    for (unsigned n = 0; n < 200; n++) {
+        ss << "float" << n << " = 1.23456789012345e-7\n"
+            << "string" << n << " = \"a long string with \\\"escapes\\\"\"\n";
+    }
+    const std::string contents = ss.str();
+    const unsigned repeats = 2000;
+    TOML::ParseOptions lazy;
+    lazy.lazy = true;
+    TOML::ParseOptions eager;
+
+    const TOML::ParseOptions* modes[2] = {&eager, &lazy};
+    double times[2];
+    for (unsigned mode = 0; mode < 2; mode++) {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        TOML::Float sum = 0;
+        for (unsigned i = 0; i < repeats; i++) {
+            TOML::Table table;
+            table.parse_string(contents, *modes[mode]);
+            TOML::Table& wide = table.get_table("wide");
+            for (unsigned n = 0; n < 200; n += 10) {
+                std::ostringstream key;
+                key << "float" << n;
+                sum += wide.get_scalar(key.str()).as_float();
+            }
+        }
+        times[mode] = seconds_since(start);
+    }
+
+    std::cout << "parse a 400-key table and read 10% of the keys:"
+        << std::endl;
+    std::cout << "    eager : " << repeats / times[0] << " configs/s"
+        << std::endl;
+    std::cout << "    lazy  : " << repeats / times[1] << " configs/s"
+        << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+// Read a mix of short and long numbers with the previous summing reader and
+// with Value, and count how many of each come back correctly rounded
+void benchmark_numbers() {
+    std::vector<std::string> numbers;
+    uint64_t state = 88172645463325252ULL;
+    for (unsigned i = 0; i < 10000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        std::ostringstream ss;
+        switch (i % 4) {
+            case 0:  // short, like most hand-written configs
+                ss << (state % 100000) / 100.0;
+                break;
+            case 1:  // scientific notation
+                ss << (state % 10000) << "e" << static_cast<int>(
+                        (state >> 32) % 60) - 30;
+                break;
+            default:  // full precision
+                double f = (state >> 11) * (1.0 / 9007199254740992.0);
+                ss << std::setprecision(17) << f * std::pow(10.0,
+                        static_cast<int>((state >> 3) % 40) - 20);
+                break;
+        }
+        numbers.push_back(ss.str());
+    }
+    const unsigned repeats = 50;
+
+    double times[2];
+    unsigned exact[2] = {0, 0};
+    for (unsigned mode = 0; mode < 2; mode++) {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        double sum = 0;
+        for (unsigned i = 0; i < repeats; i++) {
+            for (std::size_t n = 0; n < numbers.size(); n++) {
+                const char* it = numbers[n].data();
+                const char* end = it + numbers[n].size();
+                if (mode == 0) {
+                    sum += summing_parse_number(it, end);
+                } else {
+                    TOML::Value v;
+                    v.analyze(it, end);
+                    sum += v.as_float();
+                }
+            }
+        }
+        times[mode] = seconds_since(start);
+        for (std::size_t n = 0; n < numbers.size(); n++) {
+            const char* it = numbers[n].data();
+            const char* end = it + numbers[n].size();
+            double f = (mode == 0) ? summing_parse_number(it, end) :
+                TOML::Value(numbers[n]).as_float();
+            if (f == std::strtod(numbers[n].c_str(), nullptr)) {
+                exact[mode]++;
+            }
+        }
+    }
+
+    double count = static_cast<double>(repeats) * numbers.size();
+    std::cout << "read " << numbers.size() << " mixed numbers:" << std::endl;
+    std::cout << "    summing (old) : " << count / times[0] / 1.0e6
+        << " M numbers/s, " << exact[0] << " correctly rounded"
+        << std::endl;
+    std::cout << "    Value         : " << count / times[1] / 1.0e6
+        << " M numbers/s, " << exact[1] << " correctly rounded"
+        << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+// Write Floats and Integers through a std::stringstream (the way Value used
+// to) and through Value::serialize
+void benchmark_serialize() {
+    std::vector<TOML::Value> floats;
+    std::vector<TOML::Value> integers;
+    uint64_t state = 88172645463325252ULL;
+    for (unsigned i = 0; i < 10000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        TOML::Value f;
+        f.set((state >> 11) * (1.0 / 9007199254740992.0) *
+                std::pow(10.0, static_cast<int>(state % 40) - 20));
+        floats.push_back(f);
+        TOML::Value n;
+        n.set(static_cast<TOML::Integer>(state >> (state % 64)));
+        integers.push_back(n);
+    }
+    const unsigned repeats = 50;
+
+    const std::vector<TOML::Value>* inputs[2] = {&floats, &integers};
+    double times[2][2];
+    for (unsigned input = 0; input < 2; input++) {
+        const std::vector<TOML::Value>& values = *inputs[input];
+        std::size_t length = 0;
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < repeats; i++) {
+            for (std::size_t n = 0; n < values.size(); n++) {
+                std::stringstream ss;
+                if (input == 0) {
+                    ss << std::setprecision(15) << values[n].as_float();
+                } else {
+                    ss << values[n].as_integer();
+                }
+                length += ss.str().size();
+            }
+        }
+        times[input][0] = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < repeats; i++) {
+            for (std::size_t n = 0; n < values.size(); n++) {
+                length += values[n].serialize().size();
+            }
+        }
+        times[input][1] = seconds_since(start);
+        if (length == 0) {
+            std::cout << "(nothing written)" << std::endl;
+        }
+    }
+
+    double count = repeats * 10000.0;
+    std::cout << "write 10000 floats and 10000 integers:" << std::endl;
+    std::cout << "    floats, stringstream   : " << count / times[0][0] / 1.0e6
+        << " M numbers/s" << std::endl;
+    std::cout << "    floats, serialize      : " << count / times[0][1] / 1.0e6
+        << " M numbers/s" << std::endl;
+    std::cout << "    integers, stringstream : " << count / times[1][0] / 1.0e6
+        << " M numbers/s" << std::endl;
+    std::cout << "    integers, serialize    : " << count / times[1][1] / 1.0e6
+        << " M numbers/s" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a config made of long Strings and long comment blocks, where most of
+// the time goes to the scanning kernels (build with -DTOML_NO_SIMD to compare
+// against the scalar loops)
+void benchmark_scanning() {
+    std::ostringstream ss;
+    ss << "[notes]\n";
+    for (unsigned n = 0; n < 200; n++) {
+        ss << "        # ";
+        for (unsigned line = 0; line < 10; line++) {
+            ss << "Commentary on the run that explains the choice of the "
+                << "parameters below in some detail.\n        # ";
+        }
+        ss << "\n    note" << n << " = \"";
+        for (unsigned part = 0; part < 8; part++) {
+            ss << "A long description of the experiment, with a "
+                << "\\\"quoted\\\" phrase. ";
+        }
+        ss << "\"\n";
+    }
+    const std::string contents = ss.str();
+    const unsigned repeats = 200;
+
+    TOML::Table table;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        table.parse_string(contents);
+    }
+    double time = seconds_since(start);
+
+    std::cout << "parse " << contents.size()
+        << " bytes of long strings and comments:" << std::endl;
+    std::cout << "    " << repeats * contents.size() / time / 1.0e6 << " MB/s"
+        << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a config that is mostly keys: many small Tables of short key pairs,
+// where the time goes to tokenizing rather than to the Values
+void benchmark_keys() {
+    std::ostringstream ss;
+    for (unsigned n = 0; n < 500; n++) {
+        ss << "[section_" << n << ".settings]\n";
+        for (unsigned k = 0; k < 12; k++) {
+            ss << "option_name_" << k << " = " << (k % 2 == 0 ? "true" : "7")
+                << "\n";
+        }
+        ss << "\"quoted_key\" = false\n";
+    }
+    const std::string contents = ss.str();
+    const unsigned repeats = 50;
+
+    TOML::Table table;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        table.parse_string(contents);
+    }
+    double time = seconds_since(start);
+
+    std::cout << "parse " << contents.size() << " bytes of short key pairs:"
+        << std::endl;
+    std::cout << "    " << repeats * contents.size() / time / 1.0e6 << " MB/s"
+        << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+// A Handler that only sums the Floats it sees
+class FloatSum : public TOML::Handler {
+    public:
+        TOML::Float sum;
+        FloatSum(): sum(0) {}
+        void on_key_value(const std::string& /* key */,
+                const TOML::Value& value) {
+            if (value.is_valid_float()) {
+                sum += value.as_float();
+            }
+        }
+        void on_array_element(const TOML::Value& value) {
+            if (value.is_valid_float()) {
+                sum += value.as_float();
+            }
+        }
+};
+
+void benchmark_events() {
+    std::ostringstream ss;
+    for (unsigned n = 0; n < 500; n++) {
+        ss << "[section_" << n << "]\n";
+        for (unsigned k = 0; k < 10; k++) {
+            ss << "value_" << k << " = " << n + k * 0.25 << "\n";
+        }
+        ss << "list = [1.5, 2.5, 3.5]\n";
+    }
+    const std::string contents = ss.str();
+    const unsigned repeats = 50;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    TOML::Float tree_sum = 0;
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::Table table;
+        table.parse_string(contents);
+        for (unsigned n = 0; n < 500; n++) {
+            std::ostringstream name;
+            name << "section_" << n;
+            TOML::Table& section = table.get_table(name.str());
+            for (unsigned k = 0; k < 10; k++) {
+                std::ostringstream key;
+                key << "value_" << k;
+                tree_sum += section.get_scalar(key.str()).as_float();
+            }
+            TOML::ValueArray& list = section.get_array("list");
+            for (unsigned k = 0; k < list.size(); k++) {
+                tree_sum += list.at(k).as_float();
+            }
+        }
+    }
+    double tree_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    FloatSum handler;
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::parse_string(contents, handler);
+    }
+    double event_time = seconds_since(start);
+
+    std::cout << "sum the floats in " << contents.size() << " bytes:"
+        << std::endl;
+    std::cout << "    tree   : " << repeats * contents.size() / tree_time / 1.0e6
+        << " MB/s" << std::endl;
+    std::cout << "    events : "
+        << repeats * contents.size() / event_time / 1.0e6 << " MB/s"
+        << (handler.sum == tree_sum ? "" : " (sums differ!)") << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_push() {
+    const std::string contents = make_config(256 << 10);
+    const unsigned repeats = 20;
+    const std::size_t chunk = 4096;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::Table table;
+        table.parse_string(contents);
+    }
+    double whole_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::Table table;
+        TOML::PushParser parser(table);
+        for (std::size_t pos = 0; pos < contents.size(); pos += chunk) {
+            parser.feed(contents.data() + pos,
+                    std::min(chunk, contents.size() - pos));
+        }
+        parser.finish();
+    }
+    double push_time = seconds_since(start);
+
+    std::cout << "parse " << contents.size() << " bytes whole and in "
+        << chunk << "-byte chunks:" << std::endl;
+    std::cout << "    whole  : " << repeats * contents.size() / whole_time
+        / 1.0e6 << " MB/s" << std::endl;
+    std::cout << "    chunks : " << repeats * contents.size() / push_time
+        / 1.0e6 << " MB/s" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_threads() {
+    std::ostringstream ss;
+    for (unsigned n = 0; ss.tellp() < (8 << 20); n++) {
+        ss << "[section_" << n << "]\n";
+        for (unsigned k = 0; k < 100; k++) {
+            ss << "value_" << k << " = " << n + k * 0.25 << "\n";
+        }
+        ss << "name = \"section number " << n << "\"\n";
+    }
+    const std::string contents = ss.str();
+    const unsigned repeats = 3;
+
+    std::cout << "parse " << contents.size() << " bytes with "
+        << std::thread::hardware_concurrency() << " hardware threads:"
+        << std::endl;
+    const unsigned thread_counts[] = {1, 2, 4, 8};
+    for (unsigned t = 0; t < 4; t++) {
+        TOML::ParseOptions options;
+        options.threads = thread_counts[t];
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < repeats; i++) {
+            TOML::Table table;
+            table.parse_string(contents, options);
+        }
+        double time = seconds_since(start);
+        std::cout << "    " << thread_counts[t] << " thread(s) : "
+            << repeats * contents.size() / time / 1.0e6 << " MB/s"
+            << std::endl;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_batch() {
+    const unsigned file_count = 1000;
+    const std::string contents = make_config(8 << 10);
+    std::vector<std::string> filenames;
+    for (unsigned n = 0; n < file_count; n++) {
+        std::ostringstream name;
+        name << "benchmark_batch_" << std::setw(4) << std::setfill('0') << n
+            << ".toml";
+        filenames.push_back(name.str());
+        write_file(name.str(), contents);
+    }
+
+    std::cout << "parse " << file_count << " files of " << contents.size()
+        << " bytes:" << std::endl;
+    const unsigned thread_counts[] = {1, 2, 4, 8};
+    for (unsigned t = 0; t < 4; t++) {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        std::vector<TOML::ParsedFile> results =
+            TOML::parse_files(filenames, thread_counts[t]);
+        double time = seconds_since(start);
+        std::cout << "    " << thread_counts[t] << " thread(s) : "
+            << file_count / time << " files/s" << std::endl;
+    }
+
+    for (unsigned n = 0; n < file_count; n++) {
+        std::remove(filenames[n].c_str());
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_table_sizes() {
+    const unsigned sizes[] = {10, 1000, 100000};
+    std::cout << "build a table and look up every key:" << std::endl;
+    for (unsigned n = 0; n < 3; n++) {
+        const unsigned size = sizes[n];
+        std::vector<std::string> keys;
+        for (unsigned k = 0; k < size; k++) {
+            std::ostringstream key;
+            key << "key_" << (k * 7919u) % size;
+            keys.push_back(key.str());
+        }
+        // About a million operations per size
+        const unsigned repeats = 1000000 / size;
+        TOML::Value v;
+        v.set(static_cast<TOML::Integer>(1));
+
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        TOML::Table table;
+        for (unsigned i = 0; i < repeats; i++) {
+            table.clear();
+            for (unsigned k = 0; k < size; k++) {
+                table.add(keys[k], v);
+            }
+        }
+        double add_time = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        TOML::Integer sum = 0;
+        for (unsigned i = 0; i < repeats; i++) {
+            for (unsigned k = 0; k < size; k++) {
+                if (table.has(keys[k])) {
+                    sum += table.get_scalar(keys[k]).as_integer();
+                }
+            }
+        }
+        double get_time = seconds_since(start);
+
+        std::cout << "    " << std::setw(6) << size << " keys : "
+            << repeats * size / add_time / 1.0e6 << " M adds/s, "
+            << repeats * size / get_time / 1.0e6 << " M lookups/s"
+            << (sum == static_cast<TOML::Integer>(repeats) * size ? "" :
+                    " (lookups failed!)") << std::endl;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_lookup() {
+    TOML::Table table;
+    table.parse_string("turbulent_energy_fraction = 0.25\n"
+            "[magnetic_field_parameters]\nlargest_wavelength = 10.0\n");
+    const unsigned repeats = 2000000;
+    std::vector<std::string> path;
+    path.push_back("magnetic_field_parameters");
+
+    // As every lookup was made before: through a temporary std::string
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    TOML::Float sum = 0;
+    for (unsigned i = 0; i < repeats; i++) {
+        sum += table.get_scalar(std::string("turbulent_energy_fraction"))
+            .as_float();
+        std::vector<std::string> copy = path;
+        sum += table.get_table(copy).get_scalar(
+                std::string("largest_wavelength")).as_float();
+    }
+    double string_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        sum += table.get_scalar("turbulent_energy_fraction").as_float();
+        sum += table.get_table(path).get_scalar("largest_wavelength")
+            .as_float();
+    }
+    double view_time = seconds_since(start);
+
+    std::cout << "look up a key and a key under a path (" << sum << "):"
+        << std::endl;
+    std::cout << "    temporary strings : " << repeats / string_time / 1.0e6
+        << " M pairs/s" << std::endl;
+    std::cout << "    KeyView           : " << repeats / view_time / 1.0e6
+        << " M pairs/s" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_symbols() {
+    std::ostringstream ss;
+    for (unsigned n = 0; n < 5000; n++) {
+        ss << "[particle_" << n << "]\n"
+            << "particle_mass = 1.0\nparticle_charge = -1.0\n"
+            << "initial_position = [0.0, 1.0, 2.0]\n"
+            << "initial_velocity = [0.5, 0.5, 0.5]\n";
+    }
+    const std::string contents = ss.str();
+    const unsigned repeats = 5;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    TOML::Table table;
+    for (unsigned i = 0; i < repeats; i++) {
+        table.parse_string(contents);
+    }
+    double parse_time = seconds_since(start);
+
+    std::vector<std::string> names = table.table_keys();
+    std::vector<TOML::Table*> particles;
+    for (unsigned n = 0; n < names.size(); n++) {
+        particles.push_back(&table.get_table(names[n]));
+    }
+    const unsigned lookups = 200;
+    start = std::chrono::steady_clock::now();
+    TOML::Float sum = 0;
+    for (unsigned i = 0; i < lookups; i++) {
+        for (unsigned n = 0; n < particles.size(); n++) {
+            sum += particles[n]->get_scalar("particle_mass").as_float();
+            sum += particles[n]->get_scalar("particle_charge").as_float();
+        }
+    }
+    double name_time = seconds_since(start);
+
+    TOML::Symbol mass = table.symbol("particle_mass");
+    TOML::Symbol charge = table.symbol("particle_charge");
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < lookups; i++) {
+        for (unsigned n = 0; n < particles.size(); n++) {
+            sum += particles[n]->get_scalar(mass).as_float();
+            sum += particles[n]->get_scalar(charge).as_float();
+        }
+    }
+    double symbol_time = seconds_since(start);
+
+    std::cout << "parse " << names.size() << " particle tables (" << sum
+        << "):" << std::endl;
+    std::cout << "    parse   : " << repeats * contents.size() / parse_time
+        / 1.0e6 << " MB/s, " << table.key_pool()->size() << " keys in "
+        << table.key_pool()->bytes() << " bytes" << std::endl;
+    std::cout << "    by name : " << 2 * lookups * particles.size()
+        / name_time / 1.0e6 << " M lookups/s" << std::endl;
+    std::cout << "    by id   : " << 2 * lookups * particles.size()
+        / symbol_time / 1.0e6 << " M lookups/s" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_paths() {
+    TOML::Table table;
+    table.parse_file("eta000.toml");
+    const unsigned repeats = 5000000;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    TOML::Float sum = 0;
+    for (unsigned i = 0; i < repeats; i++) {
+        sum += table.get_table("experiment").get_scalar("step_small")
+            .as_float();
+        sum += table.get_table("field").get_scalar("wave_speed").as_float();
+    }
+    double nested_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    TOML::Path step_small = table.resolve("experiment.step_small");
+    TOML::Path wave_speed = table.resolve("field.wave_speed");
+    for (unsigned i = 0; i < repeats; i++) {
+        sum += step_small.get_scalar().as_float();
+        sum += wave_speed.get_scalar().as_float();
+    }
+    double path_time = seconds_since(start);
+
+    std::cout << "read two nested parameters (" << sum << "):" << std::endl;
+    std::cout << "    get_table/get_scalar : " << 2 * repeats / nested_time
+        / 1.0e6 << " M reads/s" << std::endl;
+    std::cout << "    Path                 : " << 2 * repeats / path_time
+        / 1.0e6 << " M reads/s" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+// The parameters of particle.cpp
+struct ParticleParameters {
+    TOML::Float turb_ener_frac, spectral_index, max_wave, min_wave,
+        wave_resolution, wave_speed, max_time, step_small;
+    TOML::String name, notes, experiment_directory, field_stub, particle_stub;
+    TOML::Integer number_of_particles, particle_seed, number_of_fields,
+        field_seed, max_steps;
+};
+
+void benchmark_binding() {
+    typedef ParticleParameters P;
+    TOML::Table table;
+    table.parse_file("eta000.toml");
+    const unsigned repeats = 200000;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    P p;
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::Table& field = table.get_table("field");
+        p.turb_ener_frac = field.get_scalar("turb_ener_frac").as_float();
+        p.spectral_index = field.get_scalar("spectral_index").as_float();
+        p.max_wave = field.get_scalar("max_wave").as_float();
+        p.min_wave = field.get_scalar("min_wave").as_float();
+        p.wave_resolution = field.get_scalar("wave_resolution").as_float();
+        p.wave_speed = field.get_scalar("wave_speed").as_float();
+        TOML::Table& experiment = table.get_table("experiment");
+        p.name = experiment.get_scalar("name").as_string();
+        p.notes = experiment.get_scalar("notes").as_string();
+        p.max_time = experiment.get_scalar("max_time").as_float();
+        p.number_of_particles =
+            experiment.get_scalar("number_of_particles").as_integer();
+        p.particle_seed = experiment.get_scalar("particle_seed").as_integer();
+        p.number_of_fields =
+            experiment.get_scalar("number_of_fields").as_integer();
+        p.field_seed = experiment.get_scalar("field_seed").as_integer();
+        p.experiment_directory =
+            experiment.get_scalar("experiment_directory").as_string();
+        p.field_stub = experiment.get_scalar("field_stub").as_string();
+        p.particle_stub = experiment.get_scalar("particle_stub").as_string();
+        p.step_small = experiment.get_scalar("step_small").as_float();
+        p.max_steps = experiment.get_scalar("max_steps").as_integer();
+    }
+    double get_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    TOML::Binding<P> binding;
+    binding.bind("field.turb_ener_frac", &P::turb_ener_frac)
+           .bind("field.spectral_index", &P::spectral_index)
+           .bind("field.max_wave", &P::max_wave)
+           .bind("field.min_wave", &P::min_wave)
+           .bind("field.wave_resolution", &P::wave_resolution)
+           .bind("field.wave_speed", &P::wave_speed)
+           .bind("experiment.name", &P::name)
+           .bind("experiment.notes", &P::notes)
+           .bind("experiment.max_time", &P::max_time)
+           .bind("experiment.number_of_particles", &P::number_of_particles)
+           .bind("experiment.particle_seed", &P::particle_seed)
+           .bind("experiment.number_of_fields", &P::number_of_fields)
+           .bind("experiment.field_seed", &P::field_seed)
+           .bind("experiment.experiment_directory",
+                   &P::experiment_directory)
+           .bind("experiment.field_stub", &P::field_stub)
+           .bind("experiment.particle_stub", &P::particle_stub)
+           .bind("experiment.step_small", &P::step_small)
+           .bind("experiment.max_steps", &P::max_steps);
+    for (unsigned i = 0; i < repeats; i++) {
+        binding.extract(table, p);
+    }
+    double binding_time = seconds_since(start);
+
+    std::cout << "fill in the 18 parameters of particle.cpp (" << p.max_steps
+        << "):" << std::endl;
+    std::cout << "    get_table/get_scalar : " << repeats / get_time / 1.0e3
+        << " k structs/s" << std::endl;
+    std::cout << "    Binding              : " << repeats / binding_time
+        / 1.0e3 << " k structs/s" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_static_keys() {
+    TOML::Table table;
+    table.parse_file("eta000.toml");
+    TOML::Table& experiment = table.get_table("experiment");
+    const unsigned repeats = 5000000;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    TOML::Integer sum = 0;
+    for (unsigned i = 0; i < repeats; i++) {
+        sum += experiment.get_scalar(std::string("max_steps")).as_integer();
+        sum += experiment.get_scalar(std::string("number_of_particles"))
+            .as_integer();
+    }
+    double string_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        sum += experiment.get_scalar("max_steps").as_integer();
+        sum += experiment.get_scalar("number_of_particles").as_integer();
+    }
+    double view_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        sum += experiment.get_scalar(TOML_KEY("max_steps")).as_integer();
+        sum += experiment.get_scalar(TOML_KEY("number_of_particles"))
+            .as_integer();
+    }
+    double static_time = seconds_since(start);
+
+    std::cout << "look up two keys by name (" << sum << "):" << std::endl;
+    std::cout << "    std::string : " << 2 * repeats / string_time / 1.0e6
+        << " M lookups/s" << std::endl;
+    std::cout << "    literal     : " << 2 * repeats / view_time / 1.0e6
+        << " M lookups/s" << std::endl;
+    std::cout << "    TOML_KEY    : " << 2 * repeats / static_time / 1.0e6
+        << " M lookups/s" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_moves() {
+    const unsigned count = 2000;
+    const TOML::Value text("\"a string that is too long to be kept inline\"");
+    std::vector<std::string> keys;
+    for (unsigned i = 0; i < 20; i++) {
+        keys.push_back("key_" + std::to_string(i));
+    }
+
+    double copy_time = 0;
+    double move_time = 0;
+    for (unsigned pass = 0; pass < 2; pass++) {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        TOML::Table root;
+        for (unsigned i = 0; i < count; i++) {
+            TOML::Table sub;
+            for (unsigned k = 0; k < keys.size(); k++) {
+                sub.add(keys[k], text);
+            }
+            if (pass == 0) {
+                root.add("t" + std::to_string(i), sub);
+            } else {
+                root.add("t" + std::to_string(i), std::move(sub));
+            }
+        }
+        (pass == 0 ? copy_time : move_time) = seconds_since(start);
+    }
+
+    std::cout << "build " << count << " sub-Tables of " << keys.size()
+        << " Strings and add them:" << std::endl;
+    std::cout << "    copied : " << count / copy_time / 1.0e3
+        << " k Tables/s" << std::endl;
+    std::cout << "    moved  : " << count / move_time / 1.0e3
+        << " k Tables/s" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_copies() {
+    TOML::Table table;
+    table.parse_string(make_config(100000));
+    const unsigned repeats = 200;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::Table copy(table, nullptr);
+    }
+    double deep_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::Table copy(table);
+    }
+    double shared_time = seconds_since(start);
+
+    // Copy, then change one Value in one sub-Table
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::Table copy(table, nullptr);
+        copy.get_table("experiment7").get_scalar("max_steps").set(
+                static_cast<TOML::Integer>(i));
+    }
+    double deep_change_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        TOML::Table copy(table);
+        copy.get_table("experiment7").get_scalar("max_steps").set(
+                static_cast<TOML::Integer>(i));
+    }
+    double shared_change_time = seconds_since(start);
+
+    std::cout << "copy a table of " << table.table_keys().size()
+        << " sub-Tables (and change one Value):" << std::endl;
+    std::cout << "    deep copy      : " << repeats / deep_time
+        << " copies/s (" << repeats / deep_change_time << ")" << std::endl;
+    std::cout << "    copy-on-write  : " << repeats / shared_time
+        << " copies/s (" << repeats / shared_change_time << ")" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+// Look up three scalars in each sub-Table, over and over, on several threads
+template <class T>
+double frozen_lookups(T& table, const std::vector<std::string>& names,
+        const unsigned threads, const unsigned repeats) {
+    std::vector<double> sums(threads, 0.0);
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++) {
+        pool.push_back(std::thread([&, t]() {
+            double sum = 0;
+            for (unsigned i = 0; i < repeats; i++) {
+                for (unsigned n = 0; n < names.size(); n++) {
+                    sum += table.get_table(names[n])
+                        .get_scalar("step_small").as_float();
+                    sum += table.get_table(names[n])
+                        .get_scalar("max_time").as_float();
+                    sum += table.get_table(names[n])
+                        .get_scalar("max_steps").as_float();
+                }
+            }
+            sums[t] = sum;
+        }));
+    }
+    for (unsigned t = 0; t < threads; t++) {
+        pool[t].join();
+    }
+    return threads * repeats * 3.0 * names.size() / seconds_since(start);
+}
+
+void benchmark_frozen() {
+    TOML::Table table;
+    table.parse_string(make_config(100000));
+    std::vector<std::string> names;
+    std::vector<std::string> keys = table.table_keys();
+    for (unsigned n = 0; n < keys.size(); n++) {
+        if (keys[n].compare(0, 10, "experiment") == 0) {
+            names.push_back(keys[n]);
+        }
+    }
+
+    const unsigned repeats = 500;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    TOML::FrozenTable frozen;
+    for (unsigned i = 0; i < repeats; i++) {
+        frozen = table.freeze();
+    }
+    double freeze_time = seconds_since(start);
+
+    std::cout << "look up scalars in " << names.size() << " sub-Tables ("
+        << frozen.bytes() << " bytes frozen, " << repeats / freeze_time
+        << " freezes/s):" << std::endl;
+    unsigned threads = std::thread::hardware_concurrency();
+    if (threads < 2) {
+        threads = 2;
+    }
+    const unsigned thread_counts[] = {1, threads};
+    for (unsigned c = 0; c < 2; c++) {
+        double table_rate = frozen_lookups(table, names, thread_counts[c],
+                repeats);
+        double frozen_rate = frozen_lookups(frozen, names, thread_counts[c],
+                repeats);
+        std::cout << "    " << thread_counts[c] << " thread(s) : Table "
+            << table_rate / 1.0e6 << ", FrozenTable " << frozen_rate / 1.0e6
+            << " M lookups/s" << std::endl;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Read a config on two threads while a third reloads it, through a
+// ConfigHandle and through a shared_ptr guarded by a mutex
+void benchmark_reload() {
+    const std::string filename = "benchmark_reload.toml";
+    write_file(filename, make_config(1500));
+    const unsigned reads = 500000;
+    const unsigned threads = 2;
+
+    TOML::ConfigHandle config(filename);
+    std::mutex lock;
+    std::shared_ptr<const TOML::FrozenTable> guarded(
+            new TOML::FrozenTable(*config.read()));
+
+    double rates[2];
+    unsigned long reloads[2];
+    double sum = 0;
+    for (unsigned mode = 0; mode < 2; mode++) {
+        std::atomic<unsigned> done(0);
+        unsigned long count = 0;
+        std::vector<double> sums(threads, 0.0);
+        std::thread writer([&]() {
+            while (done.load() < threads) {
+                if (mode == 0) {
+                    TOML::Table table;
+                    table.parse_file(filename);
+                    std::shared_ptr<const TOML::FrozenTable> fresh(
+                            new TOML::FrozenTable(table.freeze()));
+                    std::lock_guard<std::mutex> hold(lock);
+                    guarded.swap(fresh);
+                } else {
+                    config.reload();
+                }
+                count++;
+            }
+        });
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        std::vector<std::thread> readers;
+        for (unsigned t = 0; t < threads; t++) {
+            readers.push_back(std::thread([&, t]() {
+                for (unsigned i = 0; i < reads; i++) {
+                    if (mode == 0) {
+                        std::shared_ptr<const TOML::FrozenTable> snapshot;
+                        {
+                            std::lock_guard<std::mutex> hold(lock);
+                            snapshot = guarded;
+                        }
+                        sums[t] += snapshot->get_table("experiment0")
+                            .get_scalar("step_small").as_float();
+                    } else {
+                        TOML::ConfigHandle::Snapshot snapshot = config.read();
+                        sums[t] += snapshot->get_table("experiment0")
+                            .get_scalar("step_small").as_float();
+                    }
+                }
+                done.fetch_add(1);
+            }));
+        }
+        for (unsigned t = 0; t < threads; t++) {
+            readers[t].join();
+        }
+        rates[mode] = threads * reads / seconds_since(start);
+        writer.join();
+        for (unsigned t = 0; t < threads; t++) {
+            sum += sums[t];
+        }
+        reloads[mode] = count;
+    }
+
+    std::cout << "read a config on " << threads << " threads while it is "
+        << "reloaded (" << sum << "):" << std::endl;
+    std::cout << "    mutex and shared_ptr : " << rates[0] / 1.0e6
+        << " M reads/s (" << reloads[0] << " reloads)" << std::endl;
+    std::cout << "    ConfigHandle         : " << rates[1] / 1.0e6
+        << " M reads/s (" << reloads[1] << " reloads)" << std::endl;
+
+    std::remove(filename.c_str());
+}
+
+// ----------------------------------------------------------------------------
+
+// Change one value in the middle of a large config, and bring a Table up to
+// date by parsing it all again or only the section that changed
+void benchmark_incremental() {
+    std::string versions[2];
+    versions[0] = make_config(10 << 20);
+    versions[1] = versions[0];
+    const std::size_t middle = versions[1].find("max_steps = 100000",
+            versions[1].size() / 2);
+    versions[1].replace(middle, 18, "max_steps = 200000");
+    const unsigned repeats = 6;
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    TOML::Table table;
+    for (unsigned i = 0; i < repeats; i++) {
+        table.parse_string(versions[i % 2]);
+    }
+    double full_time = seconds_since(start);
+
+    TOML::Table edited;
+    TOML::IncrementalParser parser(edited);
+    parser.parse_string(versions[1]);
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeats; i++) {
+        parser.parse_string(versions[i % 2]);
+    }
+    double incremental_time = seconds_since(start);
+
+    std::cout << "reload a " << versions[0].size() << " byte config after "
+        << "changing one value (" << parser.changed().size()
+        << " section parsed):" << std::endl;
+    std::cout << "    full parse  : " << 1.0e3 * full_time / repeats
+        << " ms" << std::endl;
+    std::cout << "    incremental : " << 1.0e3 * incremental_time / repeats
+        << " ms" << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+
+// Read a small (eta000.toml-sized) and a large config by parsing them, and
+// through the binary cache
+void benchmark_cache() {
+    const std::size_t sizes[] = {1500, 10 << 20};
+    const unsigned repeat_counts[] = {5000, 5};
+    std::cout << "parse a file, or load it from the binary cache:"
+        << std::endl;
+    for (unsigned c = 0; c < 2; c++) {
+        const std::string filename = "benchmark_cache.toml";
+        const std::string contents = make_config(sizes[c]);
+        write_file(filename, contents);
+        const unsigned repeats = repeat_counts[c];
+
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < repeats; i++) {
+            TOML::Table table;
+            table.parse_file(filename);
+        }
+        double parse_time = seconds_since(start);
+
+        TOML::parse_file_cached(filename);  // Write the cache
+        start = std::chrono::steady_clock::now();
+        std::size_t bytes = 0;
+        for (unsigned i = 0; i < repeats; i++) {
+            bytes = TOML::parse_file_cached(filename).bytes();
+        }
+        double cached_time = seconds_since(start);
+
+        std::cout << "    " << contents.size() << " bytes (" << bytes
+            << " cached) : parse " << 1.0e3 * parse_time / repeats
+            << " ms, cached " << 1.0e3 * cached_time / repeats << " ms"
+            << std::endl;
+        std::remove(filename.c_str());
+        std::remove((filename + ".bin").c_str());
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void benchmark_arrays() {
+    const unsigned count = 1000000;
+    std::ostringstream ss;
+    ss << "samples = [";
+    for (unsigned i = 0; i < count; i++) {
+        ss << (i == 0 ? "" : ", ") << i + 0.25;
+    }
+    ss << "]\n";
+    const std::string document = ss.str();
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    TOML::Table table;
+    table.parse_string(document);
+    double parse_time = seconds_since(start);
+    const TOML::ValueArray& samples = table.get_array("samples");
+
+    const unsigned repeats = 20;
+    double sums[3] = {0, 0, 0};
+    start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < repeats; r++) {
+        double sum = 0;
+        for (unsigned i = 0; i < samples.size(); i++) {
+            sum += samples.at(i).as_float();
+        }
+        sums[0] += sum;
+    }
+    double at_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < repeats; r++) {
+        std::vector<TOML::Float> v = samples.as_float();
+        sums[1] += std::accumulate(v.begin(), v.end(), 0.0);
+    }
+    double vector_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < repeats; r++) {
+        const TOML::Float* data = samples.float_data();
+        sums[2] += std::accumulate(data, data + samples.size(), 0.0);
+    }
+    double data_time = seconds_since(start);
+
+    std::cout << "read an array of " << count << " Floats (parsed in "
+        << 1.0e3 * parse_time << " ms):" << std::endl;
+    std::cout << "    at()        : " << 1.0e3 * at_time / repeats << " ms"
+        << std::endl;
+    std::cout << "    as_float()  : " << 1.0e3 * vector_time / repeats
+        << " ms" << std::endl;
+    std::cout << "    float_data(): " << 1.0e3 * data_time / repeats
+        << " ms" << std::endl;
+    if (sums[0] != sums[1] || sums[1] != sums[2]) {
+        std::cout << "    (the sums differ)" << std::endl;
+    }
+}
+
+// ============================================================================
+
+int main(int argc, char *argv[]) {
+    benchmark_parse_file();
+    benchmark_arena();
+    benchmark_lazy();
+    benchmark_numbers();
+    benchmark_serialize();
+    benchmark_scanning();
+    benchmark_keys();
+    benchmark_events();
+    benchmark_push();
+    benchmark_threads();
+    benchmark_batch();
+    benchmark_table_sizes();
+    benchmark_lookup();
+    benchmark_symbols();
+    benchmark_paths();
+    benchmark_binding();
+    benchmark_static_keys();
+    benchmark_moves();
+    benchmark_copies();
+    benchmark_frozen();
+    benchmark_reload();
+    benchmark_incremental();
+    benchmark_cache();
+    benchmark_arrays();
+    return 0;
+}
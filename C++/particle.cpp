@@ -3,91 +3,103 @@
 
 #include "toml.h"
 
+// The parameters of a run
+struct Parameters {
+    TOML::Float field__turb_ener_frac;
+    TOML::Float field__spectral_index;
+    TOML::Float field__max_wave;
+    TOML::Float field__min_wave;
+    TOML::Float field__wave_resolution;
+    TOML::Float field__wave_speed;
+
+    TOML::String experiment__name;
+    TOML::String experiment__notes;
+    TOML::Float experiment__max_time;
+    TOML::Integer experiment__number_of_particles;
+    TOML::Integer experiment__particle_seed;
+    TOML::Integer experiment__number_of_fields;
+    TOML::Integer experiment__field_seed;
+    TOML::String experiment__experiment_directory;
+    TOML::String experiment__field_stub;
+    TOML::String experiment__particle_stub;
+    TOML::Float experiment__step_small;
+    TOML::Integer experiment__max_steps;
+};
+
 int main(int argc, char *argv[]) {
 
     std::string filename = "eta000.toml";
 
-    TOML::Table table, subtable;
+    TOML::Table table;
     table.parse_file(filename);
 
-    subtable = table.get_table("field");
-    TOML::Float field__turb_ener_frac =
-        subtable.get_scalar("turb_ener_frac").as_float();
-    TOML::Float field__spectral_index = 
-        subtable.get_scalar("spectral_index").as_float();
-    TOML::Float field__max_wave = 
-        subtable.get_scalar("max_wave").as_float();
-    TOML::Float field__min_wave = 
-        subtable.get_scalar("min_wave").as_float();
-    TOML::Float field__wave_resolution = 
-        subtable.get_scalar("wave_resolution").as_float();
-    TOML::Float field__wave_speed = 
-        subtable.get_scalar("wave_speed").as_float();
-
-    subtable = table.get_table("experiment");
-    TOML::String experiment__name =
-        subtable.get_scalar("name").as_string();
-    TOML::String experiment__notes =
-        subtable.get_scalar("notes").as_string();
-    TOML::Float experiment__max_time =
-        subtable.get_scalar("max_time").as_float();
-    TOML::Integer experiment__number_of_particles =
-        subtable.get_scalar("number_of_particles").as_integer();
-    TOML::Integer experiment__particle_seed =
-        subtable.get_scalar("particle_seed").as_integer();
-    TOML::Integer experiment__number_of_fields =
-        subtable.get_scalar("number_of_fields").as_integer();
-    TOML::Integer experiment__field_seed =
-        subtable.get_scalar("field_seed").as_integer();
-    TOML::String experiment__experiment_directory =
-        subtable.get_scalar("experiment_directory").as_string();
-    TOML::String experiment__field_stub =
-        subtable.get_scalar("field_stub").as_string();
-    TOML::String experiment__particle_stub =
-        subtable.get_scalar("particle_stub").as_string();
-    TOML::Float experiment__step_small =
-        subtable.get_scalar("step_small").as_float();
-    TOML::Integer experiment__max_steps =
-        subtable.get_scalar("max_steps").as_integer();
+    TOML::Binding<Parameters> binding;
+    binding
+        .bind("field.turb_ener_frac", &Parameters::field__turb_ener_frac)
+        .bind("field.spectral_index", &Parameters::field__spectral_index)
+        .bind("field.max_wave", &Parameters::field__max_wave)
+        .bind("field.min_wave", &Parameters::field__min_wave)
+        .bind("field.wave_resolution", &Parameters::field__wave_resolution)
+        .bind("field.wave_speed", &Parameters::field__wave_speed)
+        .bind("experiment.name", &Parameters::experiment__name)
+        .bind("experiment.notes", &Parameters::experiment__notes)
+        .bind("experiment.max_time", &Parameters::experiment__max_time)
+        .bind("experiment.number_of_particles",
+                &Parameters::experiment__number_of_particles)
+        .bind("experiment.particle_seed",
+                &Parameters::experiment__particle_seed)
+        .bind("experiment.number_of_fields",
+                &Parameters::experiment__number_of_fields)
+        .bind("experiment.field_seed", &Parameters::experiment__field_seed)
+        .bind("experiment.experiment_directory",
+                &Parameters::experiment__experiment_directory)
+        .bind("experiment.field_stub", &Parameters::experiment__field_stub)
+        .bind("experiment.particle_stub",
+                &Parameters::experiment__particle_stub)
+        .bind("experiment.step_small", &Parameters::experiment__step_small)
+        .bind("experiment.max_steps", &Parameters::experiment__max_steps);
+    Parameters p = binding.extract(table);
 
     std::cout << "data extracted from file " << filename << ":" << std::endl;
 
     std::cout << "    field data:" << std::endl;
-    std::cout << "        turb_ener_frac  = " << field__turb_ener_frac
+    std::cout << "        turb_ener_frac  = " << p.field__turb_ener_frac
+        << std::endl;
+    std::cout << "        spectral_index  = " << p.field__spectral_index
         << std::endl;
-    std::cout << "        spectral_index  = " << field__spectral_index
+    std::cout << "        max_wave        = " << p.field__max_wave
         << std::endl;
-    std::cout << "        max_wave        = " << field__max_wave << std::endl;
-    std::cout << "        min_wave        = " << field__min_wave << std::endl;
-    std::cout << "        wave_resolution = " << field__wave_resolution
+    std::cout << "        min_wave        = " << p.field__min_wave
         << std::endl;
-    std::cout << "        wave_speed      = " << field__wave_speed
+    std::cout << "        wave_resolution = " << p.field__wave_resolution
+        << std::endl;
+    std::cout << "        wave_speed      = " << p.field__wave_speed
         << std::endl;
 
     std::cout << "    experiment data:" << std::endl;
-    std::cout << "        name                 = " << experiment__name
+    std::cout << "        name                 = " << p.experiment__name
         << std::endl;
-    std::cout << "        notes                = " << experiment__notes
+    std::cout << "        notes                = " << p.experiment__notes
         << std::endl;
-    std::cout << "        max_time             = " << experiment__max_time
+    std::cout << "        max_time             = " << p.experiment__max_time
         << std::endl;
     std::cout << "        number_of_particles  = "
-        << experiment__number_of_particles << std::endl;
-    std::cout << "        particle_seed        = " << experiment__particle_seed
-        << std::endl;
+        << p.experiment__number_of_particles << std::endl;
+    std::cout << "        particle_seed        = "
+        << p.experiment__particle_seed << std::endl;
     std::cout << "        number_of_fields     = "
-        << experiment__number_of_fields << std::endl;
-    std::cout << "        field_seed           = " << experiment__field_seed
+        << p.experiment__number_of_fields << std::endl;
+    std::cout << "        field_seed           = " << p.experiment__field_seed
         << std::endl;
     std::cout << "        experiment_directory = "
-        << experiment__experiment_directory << std::endl;
-    std::cout << "        field_stub           = " << experiment__field_stub
-        << std::endl;
-    std::cout << "        particle_stub        = " << experiment__particle_stub
+        << p.experiment__experiment_directory << std::endl;
+    std::cout << "        field_stub           = " << p.experiment__field_stub
         << std::endl;
-    std::cout << "        step_small           = " << experiment__step_small
+    std::cout << "        particle_stub        = "
+        << p.experiment__particle_stub << std::endl;
+    std::cout << "        step_small           = " << p.experiment__step_small
         << std::endl;
-    std::cout << "        max_steps            = " << experiment__max_steps
+    std::cout << "        max_steps            = " << p.experiment__max_steps
         << std::endl;
 
     return 0;
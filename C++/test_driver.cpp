@@ -1,9 +1,39 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <new>
+#include <sstream>
+#include <thread>
 
 #include "toml.h"
 
+// Count the allocations made, so that lookups can be shown to make none (and
+// parsing to make no more than it needs to).  Some sections allocate on
+// several threads, so the count is atomic.
+static std::atomic<unsigned long> allocation_count(0);
+
+void* operator new(std::size_t size) {
+    allocation_count++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+// ============================================================================
+
 void print_value_summary(const TOML::Value v) {
     std::cout << "Summary of value:" << std::endl;
     try {
@@ -55,6 +85,42 @@ void try_to_set(TOML::Value& v, const std::string s) {
 
 // ============================================================================
 
+// A Handler that prints the events it is sent
+class EventPrinter : public TOML::Handler {
+    public:
+        void on_table_header(const std::vector<std::string>& path) {
+            std::cout << "    table:";
+            for (unsigned i = 0; i < path.size(); i++) {
+                std::cout << " " << path[i];
+            }
+            std::cout << std::endl;
+        }
+        void on_key_value(const std::string& key, const TOML::Value& value) {
+            std::cout << "    key: " << key << " = " << value << std::endl;
+        }
+        void on_array_begin(const std::string& key) {
+            std::cout << "    array: " << key << " =";
+        }
+        void on_array_element(const TOML::Value& value) {
+            std::cout << " " << value;
+        }
+        void on_array_end() {
+            std::cout << std::endl;
+        }
+};
+
+// ============================================================================
+
+// A struct filled in by a Binding
+struct Settings {
+    TOML::Float maybe;
+    TOML::Boolean yes;
+    TOML::String name;
+    TOML::Integer count;
+};
+
+// ----------------------------------------------------------------------------
+
 int main(int argc, char *argv[]) {
     TOML::Value v;
     print_value_summary(v);
@@ -136,5 +202,724 @@ int main(int argc, char *argv[]) {
     }
     std::cout << table.serialize(2);
 
+    std::cout << std::endl;
+    std::cout << "Parsing lazily." << std::endl;
+    {
+        TOML::ParseOptions options;
+        options.lazy = true;
+        TOML::Table lazy_table;
+        lazy_table.parse_file("parameters.toml", options);
+        table.parse_file("parameters.toml");
+        std::cout << "    string9 --> " << lazy_table.get_scalar("string9")
+            << std::endl;
+        std::cout << "    float4 as a float --> "
+            << lazy_table.get_scalar("float4").as_float() << std::endl;
+        if (lazy_table.serialize() == table.serialize()) {
+            std::cout << "    Lazy and eager parses agree." << std::endl;
+        } else {
+            std::cout << " !! Lazy and eager parses differ." << std::endl;
+        }
+        try {
+            lazy_table.parse_string("bad = \"\\q\"", options);
+            std::cout << " !! Lazy parse accepted a bad escape." << std::endl;
+        } catch (TOML::ParseError& pe) {
+            std::cout << "    Lazy parse rejected a bad escape: " << pe.what()
+                << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << "Parsing into an Arena." << std::endl;
+    TOML::Arena arena;
+    for (unsigned pass = 0; pass < 2; pass++) {
+        TOML::Table arena_table(arena);
+        arena_table.parse_file("parameters.toml");
+        table.parse_file("parameters.toml");
+        if (arena_table.serialize() == table.serialize()) {
+            std::cout << "    Arena and heap parses agree." << std::endl;
+        } else {
+            std::cout << " !! Arena and heap parses differ." << std::endl;
+        }
+        TOML::Table copy = arena_table.get_table("subtable");
+        arena_table.clear();
+        arena.reset();
+        std::cout << "    copy outlives the Arena: "
+            << copy.get_scalar("maybe") << std::endl;
+    }
+    {
+        TOML::Arena small_arena(0);
+        TOML::Table small(small_arena);
+        small.parse_string("x = 1\n");
+        std::cout << "    An Arena with no initial size: x = "
+            << small.get_scalar("x") << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Reading numbers exactly." << std::endl;
+    {
+        // Decimal strings and the bits of their correctly rounded Floats,
+        // including halfway cases, long mantissas, and the subnormal and
+        // overflow boundaries
+        struct {
+            const char* text;
+            uint64_t bits;
+        } corpus[] = {
+        {"6.022e23", 0x44DFE154F457EA13ULL},
+        {"12345678901234567.89", 0x4345EE2A2EB5A5C4ULL},
+        {"1.6E-19", 0x3C079CA10C924223ULL},
+        {"0.1", 0x3FB999999999999AULL},
+        {"0.3", 0x3FD3333333333333ULL},
+        {"2.2250738585072011e-308", 0x000FFFFFFFFFFFFFULL},
+        {"2.2250738585072012e-308", 0x0010000000000000ULL},
+        {"4.9406564584124654e-324", 0x0000000000000001ULL},
+        {"2.4703282292062328e-324", 0x0000000000000001ULL},
+        {"1.7976931348623157e308", 0x7FEFFFFFFFFFFFFFULL},
+        {"9007199254740993.0", 0x4340000000000000ULL},
+        {"7.038531e-26", 0x3AB5C87FB0000000ULL},
+        {"1e23", 0x44B52D02C7E14AF6ULL},
+        {"8.98846567431158e307", 0x7FE0000000000000ULL},
+        {"3.1415926535897932384626433832795028841971693993751",
+            0x400921FB54442D18ULL},
+        {"9007199254740992.999999999999999999999999999",
+            0x4340000000000000ULL},
+        {"123456789012345678901234567890e-10", 0x43E56A95319D63E1ULL},
+        {"1e-400", 0x0000000000000000ULL},
+        {"1e400", 0x7FF0000000000000ULL},
+        };
+        unsigned wrong = 0;
+        for (std::size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+            TOML::Float f = TOML::Value(corpus[i].text).as_float();
+            uint64_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            if (bits != corpus[i].bits) {
+                std::cout << " !! " << corpus[i].text << " read as "
+                    << std::setprecision(17) << f << std::endl;
+                wrong++;
+            }
+        }
+        std::cout << "    Corpus values read wrongly: " << wrong << std::endl;
+
+        // Every finite Float printed with 17 significant digits must read
+        // back as exactly the same Float
+        uint64_t state = 88172645463325252ULL;
+        unsigned mismatches = 0;
+        for (unsigned i = 0; i < 100000; i++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            TOML::Float f;
+            std::memcpy(&f, &state, sizeof(f));
+            if (!std::isfinite(f)) {
+                continue;
+            }
+            std::ostringstream ss;
+            ss << std::setprecision(17) << f;
+            if (TOML::Value(ss.str()).as_float() != f) {
+                mismatches++;
+            }
+        }
+        std::cout << "    Round-trip mismatches: " << mismatches << std::endl;
+
+        // Integers are checked for overflow rather than wrapping around
+        const char* integers[] = {"9223372036854775807",
+            "-9223372036854775808", "9223372036854775808"};
+        for (unsigned i = 0; i < 3; i++) {
+            TOML::Value v(integers[i]);
+            std::cout << "    " << integers[i] << (v.is_valid_integer() ?
+                    " is an integer" : " is not an integer") << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << "Writing numbers exactly." << std::endl;
+    {
+        // Sample every binary exponent (subnormals included) with the
+        // smallest, largest, and a spread of other mantissas, write each
+        // Float out and read it back
+        unsigned mismatches = 0;
+        unsigned written = 0;
+        uint64_t state = 88172645463325252ULL;
+        for (uint64_t exponent = 0; exponent < 0x7FF; exponent++) {
+            for (unsigned k = 0; k < 64; k++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                uint64_t mantissa = (k == 0) ? 1 :
+                    (k == 1) ? 0xFFFFFFFFFFFFFULL :
+                    (state & 0xFFFFFFFFFFFFFULL);
+                uint64_t bits = (exponent << 52) | mantissa;
+                TOML::Float f;
+                std::memcpy(&f, &bits, sizeof(f));
+                TOML::Value v;
+                v.set(k % 2 == 0 ? f : -f);
+                if (TOML::Value(v.serialize()).as_float() != v.as_float()) {
+                    mismatches++;
+                }
+                written++;
+            }
+        }
+        std::cout << "    Round-trip mismatches: " << mismatches << " of "
+            << written << std::endl;
+
+        // The fewest digits that read back exactly are written
+        TOML::Float floats[] = {0.1 + 0.2, 5e-324, 1.7976931348623157e308,
+            -2.5e-5, 1.0 / 3.0};
+        for (unsigned i = 0; i < 5; i++) {
+            TOML::Value v;
+            v.set(floats[i]);
+            std::cout << "    " << v << std::endl;
+        }
+        TOML::Value v;
+        v.set(static_cast<TOML::Integer>(-9223372036854775807LL - 1));
+        std::cout << "    " << v << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Parsing events." << std::endl;
+    {
+        // No Table is built: the Handler sees each part as it is read
+        EventPrinter printer;
+        TOML::parse_string("title = \"events\"\n[a.b]  # comment\n"
+                "n = 3\nlist = [1.5, 2.5]\n", printer);
+    }
+
+    std::cout << std::endl;
+    std::cout << "Parsing in pieces." << std::endl;
+    {
+        // The chunks split keys, Strings, numbers, and arrays
+        const std::string document = "name = \"in pieces\"\n[a]\n"
+            "pi = 3.14159\nlist = [1, 2, 3]\nlast = true";
+        TOML::Table t;
+        TOML::PushParser parser(t);
+        for (std::size_t i = 0; i < document.size(); i += 5) {
+            parser.feed(document.data() + i,
+                    std::min<std::size_t>(5, document.size() - i));
+        }
+        parser.finish();
+        std::cout << t;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Parsing on several threads." << std::endl;
+    {
+        TOML::ParseOptions options;
+        options.threads = 4;
+        TOML::Table parallel_table;
+        parallel_table.parse_file("parameters.toml", options);
+        table.parse_file("parameters.toml");
+        if (parallel_table.serialize() == table.serialize()) {
+            std::cout << "    Parallel and serial parses agree." << std::endl;
+        } else {
+            std::cout << " !! Parallel and serial parses differ." << std::endl;
+        }
+        // The first error in the file is the one reported
+        try {
+            parallel_table.parse_string("[a]\nx = 1\n[b]\ny = \n[a]\n"
+                    "x = 2\n", options);
+            std::cout << " !! Parallel parse accepted a bad value."
+                << std::endl;
+        } catch (TOML::ParseError& pe) {
+            std::cout << "    Parallel parse rejected the document: "
+                << pe.what() << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << "Parsing a batch of files." << std::endl;
+    {
+        std::vector<std::string> filenames;
+        filenames.push_back("parameters.toml");
+        filenames.push_back("eta000.toml");
+        filenames.push_back("no_such_file.toml");
+        std::vector<TOML::ParsedFile> results =
+            TOML::parse_files(filenames, 2);
+        for (unsigned i = 0; i < results.size(); i++) {
+            std::cout << "    " << results[i].filename << ": ";
+            if (results[i].ok()) {
+                std::cout << results[i].table.table_keys().size()
+                    << " top-level tables" << std::endl;
+            } else {
+                std::cout << results[i].message() << std::endl;
+            }
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << "Looking up keys without allocating." << std::endl;
+    {
+        TOML::Table t;
+        t.parse_file("parameters.toml");
+        const std::string key = "float4";
+        std::vector<std::string> path;
+        path.push_back("subtable");
+        path.push_back("subsubtable");
+
+        const unsigned long before = allocation_count;
+        TOML::Float f = t.get_scalar("float4").as_float() +
+            t.get_scalar(key).as_float();
+        bool found = t.has("string9") && t.has_table("subtable") &&
+            t.has(path) && !t.has_array(key);
+        const TOML::Table& sub = t.get_table(path);
+        const unsigned long after = allocation_count;
+
+        std::cout << "    " << f << " " << found << " "
+            << sub.table_keys().size() << std::endl;
+        std::cout << "    Lookups made " << after - before
+            << " allocations." << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Sharing keys." << std::endl;
+    {
+        // The same names in many Tables are stored once
+        std::ostringstream ss;
+        for (unsigned n = 0; n < 100; n++) {
+            ss << "[particle_" << n << "]\nmass = " << n
+                << "\ncharge = -1\nposition = [0.0, 1.0, 2.0]\n";
+        }
+        TOML::Table t;
+        t.parse_string(ss.str());
+        std::cout << "    " << t.key_pool()->size() << " distinct keys for "
+            << t.table_keys().size() << " Tables of 3 keys each"
+            << std::endl;
+
+        // Symbols are looked up once and then found by id
+        TOML::Symbol mass = t.symbol("mass");
+        TOML::Symbol position = t.symbol("position");
+        TOML::Integer total_mass = 0;
+        TOML::Float total_position = 0;
+        std::vector<std::string> names = t.table_keys();
+        for (unsigned i = 0; i < names.size(); i++) {
+            TOML::Table& particle = t.get_table(names[i]);
+            total_mass += particle.get_scalar(mass).as_integer();
+            total_position += particle.get_array(position).at(2).as_float();
+        }
+        std::cout << "    total mass " << total_mass << ", total z "
+            << total_position << std::endl;
+
+        // A Symbol also works (by name) in a Table with another pool
+        TOML::Table other;
+        other.parse_string("mass = 7");
+        std::cout << "    mass in another Table: "
+            << other.get_scalar(mass) << ", has position: "
+            << other.has(position) << std::endl;
+
+        // Parsing again starts a new pool, and copies (which share their
+        // pool) can be changed on different threads
+        t.parse_string("mass = 1\n");
+        std::cout << "    Keys after parsing again: " << t.key_pool()->size()
+            << std::endl;
+        TOML::Table left = other;
+        TOML::Table right = other;
+        std::thread writer([&]() {
+            left.add("left", TOML::Value("1"));
+        });
+        right.add("right", TOML::Value("2"));
+        writer.join();
+        std::cout << "    Copies changed on two threads: " << left.has("left")
+            << " " << left.has("right") << " " << right.has("right")
+            << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Resolving paths." << std::endl;
+    {
+        TOML::Table t;
+        t.parse_file("parameters.toml");
+        TOML::Path maybe = t.resolve("subtable.maybe");
+        TOML::Path yes = t.resolve("subtable . \"subsubtable\".yes");
+        TOML::Path array = t.resolve("array_var");
+        TOML::Path sub = t.resolve("subtable.subsubtable");
+        std::cout << "    subtable.maybe --> " << maybe.get_scalar()
+            << std::endl;
+        std::cout << "    subtable.subsubtable.yes --> " << yes.get_scalar()
+            << std::endl;
+        std::cout << "    array_var --> " << array.get_array() << std::endl;
+        std::cout << "    subtable.subsubtable has \"no\": "
+            << sub.get_table().has("no") << std::endl;
+        const char* bad_paths[] = {"subtable.nothing", "subtable..yes",
+            "maybe.subtable"};
+        for (unsigned i = 0; i < 3; i++) {
+            try {
+                t.resolve(bad_paths[i]);
+                std::cout << " !! Resolved " << bad_paths[i] << std::endl;
+            } catch (TOML::Error& e) {
+                std::cout << "    " << bad_paths[i] << ": " << e.what()
+                    << std::endl;
+            }
+        }
+        try {
+            maybe.get_table();
+        } catch (TOML::TableError& te) {
+            std::cout << "    " << te.what() << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << "Binding a struct." << std::endl;
+    {
+        TOML::Table t;
+        t.parse_string("name = \"run\"\ncount = 3\n[subtable]\n"
+                "maybe = 0.5\n[subtable.subsubtable]\nyes = true\n");
+        TOML::Binding<Settings> binding;
+        binding.bind("subtable.maybe", &Settings::maybe)
+               .bind("subtable.subsubtable.yes", &Settings::yes)
+               .bind("name", &Settings::name)
+               .bind("count", &Settings::count);
+        Settings settings = binding.extract(t);
+        std::cout << "    maybe = " << settings.maybe << ", yes = "
+            << settings.yes << ", name = " << settings.name << ", count = "
+            << settings.count << std::endl;
+
+        t.clear();
+        t.parse_string("name = 7\n[subtable]\nmaybe = \"no\"\n");
+        try {
+            binding.extract(t, settings);
+            std::cout << " !! Extracted a bad table" << std::endl;
+        } catch (TOML::BindingError& be) {
+            for (const std::string& problem : be.problems()) {
+                std::cout << "    " << problem << std::endl;
+            }
+        }
+        std::cout << "    Unchanged: name = " << settings.name << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Keys hashed at compile time." << std::endl;
+    {
+        TOML::Table t;
+        t.parse_file("parameters.toml");
+        std::cout << "    has(integer_var): "
+            << t.has(TOML_KEY("integer_var"))
+            << ", has_array(array_var): "
+            << t.has_array(TOML_KEY("array_var"))
+            << ", has_table(yes): " << t.has_table(TOML_KEY("yes"))
+            << std::endl;
+        std::cout << "    subtable.subsubtable.yes --> "
+            << t.get_table(TOML_KEY("subtable"))
+                .get_table(TOML_KEY("subsubtable"))
+                .get_scalar(TOML_KEY("yes")) << std::endl;
+        std::cout << "    array_var --> " << t.get_array(TOML_KEY("array_var"))
+            << std::endl;
+        try {
+            t.get_scalar(TOML_KEY("subtable"));
+        } catch (TOML::TableError& te) {
+            std::cout << "    " << te.what() << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << "Moving elements in." << std::endl;
+    {
+        // The parser hands its Values over, so parsing does not copy them
+        const unsigned long most = 65;
+        unsigned long before = allocation_count;
+        TOML::Table t;
+        t.parse_file("parameters.toml");
+        unsigned long made = allocation_count - before;
+        std::cout << "    Parsing parameters.toml made " << made
+            << " allocations" << (made <= most ? "." : " (too many!).")
+            << std::endl;
+
+        TOML::Table copied, moved;
+        before = allocation_count;
+        copied.add("parameters", t);
+        const unsigned long copy_count = allocation_count - before;
+        before = allocation_count;
+        moved.add("parameters", std::move(t));
+        const unsigned long move_count = allocation_count - before;
+        std::cout << "    Moving a sub-Table in made no more allocations "
+            << "than copying it: " << (move_count <= copy_count) << std::endl;
+        std::cout << "    Same contents: "
+            << (copied.serialize() == moved.serialize()) << std::endl;
+
+        TOML::Table built;
+        TOML::Table& sub = built.add_table("sub");
+        sub.add("text", TOML::Value("\"a string too long to be inline\""));
+        TOML::ValueArray& numbers = sub.add_array("numbers");
+        numbers.add(TOML::Value("1"));
+        numbers.add(TOML::Value("2.5"));
+        std::cout << built;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Copying shares contents." << std::endl;
+    {
+        TOML::Table original;
+        original.parse_file("parameters.toml");
+        const std::string before = original.serialize();
+
+        // (Only the const getters leave a shared Table unchanged)
+        const TOML::Table& shared = original;
+        unsigned long count = allocation_count;
+        TOML::Table copy = original;
+        TOML::Table sub = shared.get_table("subtable");
+        std::cout << "    Copying made " << allocation_count - count
+            << " allocations." << std::endl;
+
+        const TOML::Table& view = sub;
+        count = allocation_count;
+        const TOML::Value& maybe = view.get_scalar("maybe");
+        const TOML::ValueArray& array = shared.get_array("array_var");
+        std::cout << "    Reading through const references made "
+            << allocation_count - count << " allocations (" << maybe
+            .as_float() << ", " << array.size() << " elements)."
+            << std::endl;
+
+        copy.get_table("subtable").get_table("subsubtable").add("changed",
+                TOML::Value("true"));
+        sub.add("added", TOML::Value("1"));
+        std::cout << "    Original unchanged: "
+            << (original.serialize() == before) << std::endl;
+        std::cout << "    Copy changed: " << copy.get_table("subtable")
+            .get_table("subsubtable").has("changed") << std::endl;
+        std::cout << "    Sub-Table copy changed: " << sub.has("added")
+            << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Freezing a Table." << std::endl;
+    {
+        TOML::Table table;
+        table.parse_file("parameters.toml");
+        const std::string before = table.serialize();
+        TOML::FrozenTable frozen = table.freeze();
+        table.clear();
+
+        std::cout << "    Same output: " << (frozen.serialize() == before)
+            << std::endl;
+        std::cout << "    Packed into " << frozen.bytes() << " bytes"
+            << std::endl;
+        TOML::FrozenTable sub = frozen.get_table("subtable");
+        std::cout << "    subtable keys:";
+        std::vector<std::string> keys = sub.all_keys();
+        for (auto it = keys.begin(); it != keys.end(); it++) {
+            std::cout << " " << *it;
+        }
+        std::cout << std::endl;
+        std::vector<std::string> path;
+        path.push_back("subtable");
+        path.push_back("subsubtable");
+        std::cout << "    has(subtable.subsubtable): " << frozen.has(path)
+            << std::endl;
+        std::cout << "    get_table(path): " << frozen.get_table(path)
+            .all_keys().size() << " keys" << std::endl;
+        std::cout << "    float2 --> " << frozen.get_scalar(
+                TOML_KEY("float2")).as_float() << std::endl;
+        std::cout << "    array_var --> " << frozen.get_array("array_var")
+            << std::endl;
+        try {
+            frozen.get_scalar("missing");
+        } catch (TOML::TableError& e) {
+            std::cout << "    Missing key: " << e.what() << std::endl;
+        }
+
+        TOML::Table zero;
+        TOML::Value negative_zero;
+        negative_zero.set(TOML::Float(-0.0));
+        zero.add("z", negative_zero);
+        TOML::FrozenTable frozen_zero = zero.freeze();
+        TOML::FrozenValue z = frozen_zero.get_scalar("z");
+        std::cout << "    -0.0 keeps its sign: "
+            << std::signbit(z.as_float()) << ", as an Integer "
+            << z.as_integer() << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Reloading while reading." << std::endl;
+    {
+        // Each version is checkable on its own: double is twice version
+        const std::string filename = "reload_test.toml";
+        auto write_version = [&](const unsigned n) {
+            std::ofstream fout(filename);
+            fout << "version = " << n << "\n[check]\ndouble = " << 2 * n
+                << "\nname = \"version " << n << "\"\n";
+        };
+        write_version(0);
+        TOML::ConfigHandle config(filename);
+
+        std::atomic<bool> stop(false);
+        std::atomic<unsigned> bad_reads(0);
+        std::vector<std::thread> readers;
+        for (unsigned r = 0; r < 4; r++) {
+            readers.push_back(std::thread([&]() {
+                TOML::Integer last = 0;
+                while (!stop.load()) {
+                    TOML::ConfigHandle::Snapshot snapshot = config.read();
+                    const TOML::Integer n =
+                        snapshot->get_scalar("version").as_integer();
+                    TOML::FrozenTable check = snapshot->get_table("check");
+                    if (check.get_scalar("double").as_integer() != 2 * n ||
+                            check.get_scalar("name").as_string() !=
+                            "version " + std::to_string(n) || n < last) {
+                        bad_reads.fetch_add(1);
+                    }
+                    last = n;
+                }
+            }));
+        }
+
+        unsigned failed = 0;
+        bool kept = true;
+        for (unsigned n = 1; n <= 200; n++) {
+            write_version(n);
+            config.reload();
+            if (n % 20 == 0) {
+                std::ofstream(filename) << "version = \n";
+                try {
+                    config.reload();
+                } catch (TOML::ParseError& pe) {
+                    failed++;
+                    kept &= (config.read()->get_scalar("version")
+                            .as_integer() == n);
+                }
+            }
+        }
+        stop.store(true);
+        for (unsigned r = 0; r < readers.size(); r++) {
+            readers[r].join();
+        }
+        std::remove(filename.c_str());
+
+        std::cout << "    Versions published: " << config.version()
+            << std::endl;
+        std::cout << "    Torn or out-of-order reads: " << bad_reads.load()
+            << std::endl;
+        std::cout << "    Failed reloads: " << failed
+            << ", old version kept: " << kept << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Re-parsing an edited document." << std::endl;
+    {
+        std::string document = "title = \"first\"\n[a]\nx = 1\n"
+            "[a.b]\ny = 2\n[c]\nz = 3\n";
+        TOML::Table table;
+        TOML::IncrementalParser parser(table);
+        parser.parse_string(document);
+        const TOML::Table* b = &table.get_table("a").get_table("b");
+        const TOML::Value* z = &table.get_table("c").get_scalar("z");
+
+        document.replace(document.find("x = 1"), 5, "x = 10\nw = 4");
+        parser.parse_string(document);
+        std::cout << "    Incremental: " << parser.incremental()
+            << ", changed:";
+        for (unsigned i = 0; i < parser.changed().size(); i++) {
+            std::cout << " [" << parser.changed()[i] << "]";
+        }
+        std::cout << std::endl;
+        std::cout << "    a.x = " << table.get_table("a").get_scalar("x")
+            << ", a.w = " << table.get_table("a").get_scalar("w")
+            << std::endl;
+        std::cout << "    Untouched: " << (&table.get_table("a")
+                .get_table("b") == b && &table.get_table("c")
+                .get_scalar("z") == z) << std::endl;
+
+        try {
+            parser.parse_string(document + "bad = \n");
+        } catch (TOML::ParseError& pe) {
+            std::cout << "    Error: " << pe.what() << " (a.x is still "
+                << table.get_table("a").get_scalar("x") << ")" << std::endl;
+        }
+
+        parser.parse_string(document + "[d]\n");
+        std::cout << "    After adding a section, incremental: "
+            << parser.incremental() << ", " << parser.changed().size()
+            << " sections parsed" << std::endl;
+
+        // The first error in the document, not the one in the changed section
+        TOML::Table edited;
+        TOML::IncrementalParser edits(edited);
+        edits.parse_string("x = 1\n[a]\nk=2\n");
+        try {
+            edits.parse_string("[a]\n[a]\n1");
+        } catch (TOML::ParseError& pe) {
+            std::cout << "    Duplicate header: " << pe.what() << std::endl;
+        }
+
+        TOML::Arena arena;
+        TOML::Table in_arena(arena);
+        TOML::ParseOptions options;
+        options.threads = 4;
+        TOML::IncrementalParser arena_parser(in_arena, options);
+        arena_parser.parse_string(document);
+        document.replace(document.find("x = 10"), 6, "x = 20");
+        arena_parser.parse_string(document);
+        std::cout << "    In an Arena: a.x = " << in_arena.get_table("a")
+            .get_scalar("x") << ", incremental: "
+            << arena_parser.incremental() << ", changed:";
+        for (unsigned i = 0; i < arena_parser.changed().size(); i++) {
+            std::cout << " [" << arena_parser.changed()[i] << "]";
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Caching a parsed file." << std::endl;
+    {
+        const std::string filename = "cache_test.toml";
+        {
+            std::ofstream fout(filename);
+            fout << "[run]\nsteps = 100\nname = \"first\"\n";
+        }
+        TOML::FrozenTable parsed = TOML::parse_file_cached(filename);
+        std::ifstream cache(filename + ".bin");
+        std::cout << "    Cache written: " << cache.good() << std::endl;
+        cache.close();
+
+        const unsigned long before = allocation_count;
+        TOML::FrozenTable cached = TOML::parse_file_cached(filename);
+        std::cout << "    Loaded with " << allocation_count - before
+            << " allocations, same output: "
+            << (cached.serialize() == parsed.serialize()) << std::endl;
+
+        {
+            std::ofstream fout(filename);
+            fout << "[run]\nsteps = 200\nname = \"second\"\n";
+        }
+        TOML::FrozenTable changed = TOML::parse_file_cached(filename);
+        std::cout << "    After the file changed: steps = "
+            << changed.get_table("run").get_scalar("steps") << std::endl;
+        std::remove(filename.c_str());
+        std::remove((filename + ".bin").c_str());
+    }
+
+    std::cout << std::endl;
+    std::cout << "Storing arrays of numbers." << std::endl;
+    {
+        TOML::Table table;
+        table.parse_string("steps = [10, 20, 30]\n"
+                "weights = [1, 0.5, 0.25]\n"
+                "flags = [true, false]\n"
+                "huge = [9007199254740993, 0.5]\n");
+
+        const TOML::ValueArray& steps = table.get_array("steps");
+        const TOML::Integer* step_data = steps.integer_data();
+        std::cout << "    steps as Integers: " << step_data[0] << ", "
+            << step_data[1] << ", " << step_data[2] << std::endl;
+
+        const TOML::ValueArray& weights = table.get_array("weights");
+        const TOML::Float* weight_data = weights.float_data();
+        std::cout << "    weights promoted to Floats: " << weight_data[0]
+            << ", " << weight_data[1] << ", " << weight_data[2]
+            << " (written as " << weights << ")" << std::endl;
+
+        const unsigned long before = allocation_count;
+        std::vector<TOML::Float> copy = weights.as_float();
+        std::cout << "    as_float() made " << allocation_count - before
+            << " allocation for " << copy.size() << " elements"
+            << std::endl;
+
+        std::cout << "    flags as Booleans: "
+            << (table.get_array("flags").boolean_data() != nullptr)
+            << std::endl;
+
+        const TOML::ValueArray& huge = table.get_array("huge");
+        std::cout << "    " << huge << " kept as Values: "
+            << (huge.integer_data() == nullptr &&
+                huge.float_data() == nullptr)
+            << ", first element " << huge.at(0).as_integer() << std::endl;
+    }
+
     return 0;
 }
@@ -4,693 +4,5282 @@
  * provides a subset of TOML.
  */
 
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
-#include <boost/container/flat_map.hpp>
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <boost/container/vector.hpp>
 #include <vector>
 
 #include "toml.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#define TOML_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if !defined(TOML_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__)
+#define TOML_HAVE_SSE2
+#include <emmintrin.h>
+#if defined(__x86_64__) || defined(__i386__)
+#define TOML_HAVE_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
 typedef TOML::string_it string_it;
 
 // ============================================================================
-// General parsing functions
+// File mapping
+
+// A read-only view of a whole file.  Where the platform supports it the file
+// is memory-mapped, so parsing can run directly over the page cache instead of
+// copying every line into a std::string first.  If the file cannot be mapped
+// (it does not exist, it is empty, or there is no mmap) then begin() is null
+// and the caller should fall back to reading the file as a stream.
+class MappedFile {
+    private:
+        const char* data;
+        std::size_t length;
+
+        // Not copyable (the mapping is released in the destructor)
+        MappedFile(const MappedFile&);
+        MappedFile& operator= (const MappedFile&);
+
+    public:
+        MappedFile(const std::string filename): data(nullptr), length(0) {
+#ifdef TOML_HAVE_MMAP
+            int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return;
+            }
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                void* address = mmap(nullptr, info.st_size, PROT_READ,
+                        MAP_PRIVATE, fd, 0);
+                if (address != MAP_FAILED) {
+                    data = static_cast<const char*>(address);
+                    length = info.st_size;
+                }
+            }
+            close(fd);  // The mapping stays valid after the file is closed
+#endif
+        }
+
+        ~MappedFile() {
+#ifdef TOML_HAVE_MMAP
+            if (data != nullptr) {
+                munmap(const_cast<char*>(data), length);
+            }
+#endif
+        }
+
+        const char* begin() const { return data; }
+        const char* end() const { return data + length; }
+};
+
+// ============================================================================
+// Scanning kernels
+//
+// The hot loops of the lexer -- skipping blanks, finding the end of a line,
+// and finding the next quote or backslash in a String -- look at 16 (SSE2) or
+// 32 (AVX2) characters at a time.  SSE2 is always there on x86-64; AVX2 is
+// used when the processor has it, checked once at startup.  Elsewhere, or
+// when TOML_NO_SIMD is defined, the kernels are plain loops.  The vector
+// loops never read past the end of the range: the last partial block is
+// finished by the scalar loop.
+
+#ifdef TOML_HAVE_AVX2
+// (This runs during static initialization, before the CPU model would
+// otherwise have been read.)
+static bool detect_avx2() {
+#ifdef __AVX2__
+    return true;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const bool cpu_has_avx2 = detect_avx2();
+#endif
+
+// ----------------------------------------------------------------------------
 
-// Advance the iterator while there is white space.
-void consume_whitespace(string_it& it, const string_it& end) {
+// Scalar versions, which also finish off the vector versions
+static const char* skip_blanks_scalar(const char* it, const char* end) {
     while (it != end && (*it == ' ' || *it == '\t')) {
         it++;
     }
+    return it;
 }
 
-// ----------------------------------------------------------------------------
+static const char* find_newline_scalar(const char* it, const char* end) {
+    // (The C library's memchr is usually vectorized already)
+    const void* found = std::memchr(it, '\n', end - it);
+    return (found == nullptr) ? end : static_cast<const char*>(found);
+}
 
-// Advance the iterator if the character matches the iterator; otherwise raise
-// an error.
-void consume_character(const char c, string_it& it, const string_it& end) {
-    if (it == end) {
-        throw TOML::ParseError("No character to consume.");
-    } else if (*it == c) {
+static const char* find_quote_or_backslash_scalar(const char* it,
+        const char* end) {
+    while (it != end && *it != '"' && *it != '\\') {
         it++;
-    } else {
-        std::string message = "Consume character mismatch: '";
-        message.append(1, c);
-        message.append("' != '");
-        message.append(1, *it);
-        message.append("'.");
-        throw TOML::ParseError(message);
     }
+    return it;
 }
 
 // ----------------------------------------------------------------------------
 
-// Advance the iterator to the end of the line if the iterator points to the
-// start of a comment
-void consume_comment(string_it& it, const string_it& end) {
-    consume_character(TOML::Table::comment, it, end);
-    it = end;
+#ifdef TOML_HAVE_SSE2
+// In each block, build a bit mask of the interesting characters and stop at
+// the lowest set bit
+static const char* skip_blanks_sse2(const char* it, const char* end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    while (end - it >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        unsigned blanks = _mm_movemask_epi8(_mm_or_si128(
+                    _mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)));
+        if (blanks != 0xFFFF) {
+            return it + __builtin_ctz(~blanks);
+        }
+        it += 16;
+    }
+    return skip_blanks_scalar(it, end);
+}
+
+static const char* find_newline_sse2(const char* it, const char* end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - it >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        unsigned found = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        if (found != 0) {
+            return it + __builtin_ctz(found);
+        }
+        it += 16;
+    }
+    return find_newline_scalar(it, end);
+}
+
+static const char* find_quote_or_backslash_sse2(const char* it,
+        const char* end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - it >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        unsigned found = _mm_movemask_epi8(_mm_or_si128(
+                    _mm_cmpeq_epi8(block, quote),
+                    _mm_cmpeq_epi8(block, backslash)));
+        if (found != 0) {
+            return it + __builtin_ctz(found);
+        }
+        it += 16;
+    }
+    return find_quote_or_backslash_scalar(it, end);
 }
+#endif
 
 // ----------------------------------------------------------------------------
 
-// Advance to the end of the line (ensuring that there are no trailing
-// characters beyond whitespace or a line comment)
-void consume_to_eol(string_it& it, const string_it& end) {
-    consume_whitespace(it, end);
-    if (it != end) {
-        consume_comment(it, end);
+#ifdef TOML_HAVE_AVX2
+// The same, 32 characters at a time
+__attribute__((target("avx2")))
+static const char* skip_blanks_avx2(const char* it, const char* end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    while (end - it >= 32) {
+        __m256i block = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(it));
+        unsigned blanks = _mm256_movemask_epi8(_mm256_or_si256(
+                    _mm256_cmpeq_epi8(block, space),
+                    _mm256_cmpeq_epi8(block, tab)));
+        if (blanks != 0xFFFFFFFFu) {
+            return it + __builtin_ctz(~blanks);
+        }
+        it += 32;
+    }
+    return skip_blanks_sse2(it, end);
+}
+
+__attribute__((target("avx2")))
+static const char* find_newline_avx2(const char* it, const char* end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (end - it >= 32) {
+        __m256i block = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(it));
+        unsigned found = _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(block, newline));
+        if (found != 0) {
+            return it + __builtin_ctz(found);
+        }
+        it += 32;
+    }
+    return find_newline_sse2(it, end);
+}
+
+__attribute__((target("avx2")))
+static const char* find_quote_or_backslash_avx2(const char* it,
+        const char* end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    while (end - it >= 32) {
+        __m256i block = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(it));
+        unsigned found = _mm256_movemask_epi8(_mm256_or_si256(
+                    _mm256_cmpeq_epi8(block, quote),
+                    _mm256_cmpeq_epi8(block, backslash)));
+        if (found != 0) {
+            return it + __builtin_ctz(found);
+        }
+        it += 32;
     }
+    return find_quote_or_backslash_sse2(it, end);
 }
+#endif
 
 // ----------------------------------------------------------------------------
 
-// Check if the character is a valid digit (0-9).  While functions for these
-// things exist, I don't want to tangle with issues of locale, so I hardcoded
-// my own.
-static bool is_digit(const char c) {
-    static const std::string digits("0123456789");
-    return (digits.find(c) != std::string::npos);
+// Return the first character that is not a space or tab (or end)
+static const char* skip_blanks(const char* it, const char* end) {
+#if defined(TOML_HAVE_AVX2)
+    return cpu_has_avx2 ? skip_blanks_avx2(it, end) :
+        skip_blanks_sse2(it, end);
+#elif defined(TOML_HAVE_SSE2)
+    return skip_blanks_sse2(it, end);
+#else
+    return skip_blanks_scalar(it, end);
+#endif
 }
 
 // ----------------------------------------------------------------------------
 
-// Check if the character is a valid letter (a-zA-Z).  While functions for
-// these things exist, I don't want to tangle with issues of locale, so I
-// hardcoded my own.
-static bool is_letter(const char c) {
-    static const std::string letters(
-            "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ");
-    return (letters.find(c) != std::string::npos);
+// Return the first newline (or end)
+static const char* find_newline(const char* it, const char* end) {
+#if defined(TOML_HAVE_AVX2)
+    return cpu_has_avx2 ? find_newline_avx2(it, end) :
+        find_newline_sse2(it, end);
+#elif defined(TOML_HAVE_SSE2)
+    return find_newline_sse2(it, end);
+#else
+    return find_newline_scalar(it, end);
+#endif
 }
 
 // ----------------------------------------------------------------------------
 
-// Convert a character to a digit, or raise a ParseError if the character is
-// not equivalent to a digit.  While functions for these things exist, I don't
-// want to tangle with issues of locale, so I hardcoded my own.
-static unsigned to_digit(const char c) {
-    switch(c) {
-        case '0': return 0;
-        case '1': return 1;
-        case '2': return 2;
-        case '3': return 3;
-        case '4': return 4;
-        case '5': return 5;
-        case '6': return 6;
-        case '7': return 7;
-        case '8': return 8;
-        case '9': return 9;
-        default:
-              std::string message = "Character \"";
-              message.append(1, c);
-              message.append("\" is not a digit.");
-              throw TOML::ParseError(message);
-    }
+// Return the first double-quote or backslash (or end)
+static const char* find_quote_or_backslash(const char* it, const char* end) {
+#if defined(TOML_HAVE_AVX2)
+    return cpu_has_avx2 ? find_quote_or_backslash_avx2(it, end) :
+        find_quote_or_backslash_sse2(it, end);
+#elif defined(TOML_HAVE_SSE2)
+    return find_quote_or_backslash_sse2(it, end);
+#else
+    return find_quote_or_backslash_scalar(it, end);
+#endif
 }
 
+// ============================================================================
+// Arena ______________________________________________________________________
+
+// Construct an empty Arena.  No memory is taken until the first allocation.
+TOML::Arena::Arena(const std::size_t initial_size):
+    chunks(nullptr),
+    current(nullptr),
+    limit(nullptr),
+    next_chunk_size(initial_size)
+{}
+
 // ----------------------------------------------------------------------------
 
-// Advance the iterator across a quoted key and return the key
-std::string analyze_quoted_key(string_it& it, const string_it& end) {
-    // Quoted keys follow the same rules as String values, so we can just
-    // analyze it as a value and return the String if a valid String results
-    TOML::Value v;
-    try {
-        v.analyze(it, end);
-    } catch (TOML::ParseError& err) {
-        throw TOML::ParseError("Could not parse quoted key.");
-    }
-    if (!v.is_valid_string()) {
-        throw TOML::ParseError("Could not parse quoted key.");
-    }
-    std::string s = v.as_string();
-    if (s.empty()) {
-        throw TOML::ParseError("Cannot have an empty quoted key.");
-    }
-    return v.as_string();
+TOML::Arena::~Arena() {
+    release();
 }
 
 // ----------------------------------------------------------------------------
 
-// Advance the iterator across a bare key and return the key
-std::string analyze_bare_key(string_it& it, const string_it& end) {
-    std::string key("");
-    while (it != end &&
-            (is_digit(*it) || is_letter(*it) || *it == '_' || *it == '-')) {
-        key.append(1, *it);
-        it++;
-    }
-    if (key.empty()) {
-        throw TOML::ParseError("Empty bare key.");
+// Hand out memory from the current chunk, starting a new (bigger) chunk when
+// the current one is full
+void* TOML::Arena::allocate(const std::size_t bytes,
+        const std::size_t alignment) {
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(current);
+    std::uintptr_t aligned = (address + alignment - 1) & ~(alignment - 1);
+    if (current == nullptr || aligned + bytes >
+            reinterpret_cast<std::uintptr_t>(limit)) {
+        // Chunks at least double in size, so a document needs only a
+        // logarithmic number of them (and the first is big enough even for
+        // an Arena constructed with an initial size of zero)
+        const std::size_t size = std::max(next_chunk_size, bytes + alignment);
+        next_chunk_size = 2 * size;
+        Chunk* chunk = static_cast<Chunk*>(
+                ::operator new(sizeof(Chunk) + size));
+        chunk->next = chunks;
+        chunk->size = size;
+        chunks = chunk;
+        current = reinterpret_cast<char*>(chunk + 1);
+        limit = current + size;
+        address = reinterpret_cast<std::uintptr_t>(current);
+        aligned = (address + alignment - 1) & ~(alignment - 1);
     }
-    return key;
+    current = reinterpret_cast<char*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
 }
 
 // ----------------------------------------------------------------------------
 
-// Advance the iterator across a key and return the key
-std::string analyze_key(string_it& it, const string_it& end) {
-    if (*it == '"') {
-        return analyze_quoted_key(it, end);
-    } else {
-        return analyze_bare_key(it, end);
+// Give back all of the chunks
+void TOML::Arena::release() {
+    while (chunks != nullptr) {
+        Chunk* next = chunks->next;
+        ::operator delete(chunks);
+        chunks = next;
     }
+    current = nullptr;
+    limit = nullptr;
 }
 
 // ----------------------------------------------------------------------------
 
-// Advance the iterator across a table name, and return the table name as a
-// path of keys
-std::vector<std::string> analyze_table_name(
-        string_it& it, const string_it& end) {
-    std::vector<std::string> path;
-    consume_whitespace(it, end);
-    path.push_back(analyze_key(it, end));
-    consume_whitespace(it, end);
-    while (*it == '.') {
-        it++;
-        consume_whitespace(it, end);
-        path.push_back(analyze_key(it, end));
-        consume_whitespace(it, end);
+// Give back all of the chunks except the most recent (which is the largest),
+// and start handing out memory from the beginning of that chunk again
+void TOML::Arena::reset() {
+    if (chunks == nullptr) {
+        return;
     }
-    return path;
+    Chunk* keep = chunks;
+    chunks = chunks->next;
+    release();
+    keep->next = nullptr;
+    chunks = keep;
+    current = reinterpret_cast<char*>(keep + 1);
+    limit = current + keep->size;
 }
 
 // ============================================================================
-// Value ______________________________________________________________________
+// Tokenizer
+//
+// A line is read as a stream of typed tokens.  Characters are classified by a
+// lookup table rather than by searching alphabets, and the tokenizer has two
+// modes because the same characters mean different things on either side of
+// the '=': "123" is a bare key on the left and a number on the right.
+
+// Character classes (a character may be in several)
+enum CharClass {
+    BLANK = 1,         // ' ' and '\t'
+    DIGIT = 2,         // 0-9
+    LETTER = 4,        // a-z and A-Z
+    BARE_KEY = 8,      // letters, digits, '_' and '-'
+    NUMBER_START = 16  // digits, '+', '-' and '.'
+};
+
+// The classes of each (unsigned) character.  While functions for these things
+// exist, I don't want to tangle with issues of locale, so I hardcoded my own.
+static constexpr unsigned char char_classes[256] = {
+    // 0x00 - 0x1F: control characters ('\t' is blank)
+    0, 0, 0, 0, 0, 0, 0, 0, 0, BLANK, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    // 0x20 - 0x2F: ' ' ! " # $ % & ' ( ) * + , - . /
+    BLANK, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NUMBER_START, 0,
+    BARE_KEY | NUMBER_START, NUMBER_START, 0,
+    // 0x30 - 0x3F: 0-9 : ; < = > ?
+    DIGIT | BARE_KEY | NUMBER_START, DIGIT | BARE_KEY | NUMBER_START,
+    DIGIT | BARE_KEY | NUMBER_START, DIGIT | BARE_KEY | NUMBER_START,
+    DIGIT | BARE_KEY | NUMBER_START, DIGIT | BARE_KEY | NUMBER_START,
+    DIGIT | BARE_KEY | NUMBER_START, DIGIT | BARE_KEY | NUMBER_START,
+    DIGIT | BARE_KEY | NUMBER_START, DIGIT | BARE_KEY | NUMBER_START,
+    0, 0, 0, 0, 0, 0,
+    // 0x40 - 0x5F: @ A-Z [ \ ] ^ _
+    0,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY,
+    0, 0, 0, 0, BARE_KEY,
+    // 0x60 - 0x7F: ` a-z { | } ~ DEL
+    0,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY, LETTER | BARE_KEY,
+    LETTER | BARE_KEY, LETTER | BARE_KEY,
+    0, 0, 0, 0, 0
+    // 0x80 - 0xFF: nothing (the rest of the array is zero)
+};
 
-// Clear the Value -- erase the internal values and set it to be nonconformable
-void TOML::Value::clear() {
-    // Not conformable to anything
-    is_conformable_to_string = false;
-    is_conformable_to_integer = false;
-    is_conformable_to_float = false;
-    is_conformable_to_boolean = false;
-    // Wipe the value(s)
-    value_as_string = "";
-    value_as_integer = 0;
-    value_as_float = 0.0;
-    value_as_boolean = false;
+// ----------------------------------------------------------------------------
+
+// Is the character in the given class?
+static bool has_class(const char c, const unsigned char_class) {
+    return (char_classes[static_cast<unsigned char>(c)] & char_class) != 0;
 }
 
 // ----------------------------------------------------------------------------
 
-// Attempt to parse the value as a String.  Return the String or raise a
-// ParseError if parsing fails.
-TOML::String TOML::Value::parse_string(
-        string_it& it, const string_it& end) {
-    if (*it != '"') {
+// Check if the character is a valid digit (0-9)
+static bool is_digit(const char c) {
+    return has_class(c, DIGIT);
+}
+
+// ----------------------------------------------------------------------------
+
+// Convert a character to a digit, or raise a ParseError if the character is
+// not equivalent to a digit.
+static unsigned to_digit(const char c) {
+    if (!is_digit(c)) {
+        std::string message = "Character \"";
+        message.append(1, c);
+        message.append("\" is not a digit.");
+        throw TOML::ParseError(message);
+    }
+    return c - '0';
+}
+
+// ----------------------------------------------------------------------------
+
+// Advance the iterator across a quoted string, checking that it is closed and
+// that every escape sequence is known, and return the range of characters
+// between the quotes (escape sequences still in place).  Return whether there
+// were any escape sequences.  Raise a ParseError if the string is malformed.
+static bool scan_string(string_it& it, const string_it& end,
+        string_it& body_begin, string_it& body_end) {
+    if (it == end || *it != '"') {
         throw TOML::ParseError("Unable to parse as a string.");
     }
     it++;
-    TOML::String temp_string = "";
+    body_begin = it;
+    bool escaped = false;
     while (it != end) {
-        if (*it == '\\') {
+        // Skip straight to the next character that needs a closer look
+        it = find_quote_or_backslash(it, end);
+        if (it == end) {
+            break;
+        } else if (*it == '\\') {
+            escaped = true;
             it++;
-            if (*it == '"') {
-                temp_string += "\"";
-                it++;
-            } else if (*it == '\\') {
-                temp_string += "\\";
-                it++;
-            } else if (*it == 'b') {
-                temp_string += "\b";
-                it++;
-            } else if (*it == 't') {
-                temp_string += "\t";
-                it++;
-            } else if (*it == 'n') {
-                temp_string += "\n";
-                it++;
-            } else if (*it == 'f') {
-                temp_string += "\f";
-                it++;
-            } else if (*it == 'r') {
-                temp_string += "\r";
-                it++;
-            } else {
-                std::string message = "Unknown escape character \"\\";
-                message.append(1, *it);
-                message.append("\".");
-                throw TOML::ParseError(message);
+            if (it == end) {
+                break;
+            }
+            switch (*it) {
+                case '"': case '\\': case 'b': case 't': case 'n': case 'f':
+                case 'r':
+                    it++;
+                    break;
+                default:
+                    std::string message = "Unknown escape character \"\\";
+                    message.append(1, *it);
+                    message.append("\".");
+                    throw TOML::ParseError(message);
             }
-        } else if (*it == '"') {
-            break;
         } else {
-            temp_string += *it;
-            it++;
+            break;  // The closing '"'
         }
     }
-    if (*it != '"') {
+    if (it == end || *it != '"') {
         throw TOML::ParseError("Unable to parse as a string.");
     }
+    body_end = it;
     it++;
-    return temp_string;
+    return escaped;
 }
 
 // ----------------------------------------------------------------------------
 
-// Attempt to parse the value as a Boolean.  Return the Boolean or raise a
-// ParseError if parsing fails.
-TOML::Boolean TOML::Value::parse_boolean(
-        string_it& it, const string_it& end) {
-    TOML::Boolean temp_bool;
-    if (std::string(it, it+4) == "true") {
-        it = it + 4;
-        temp_bool = true;
-    } else if (std::string(it, it+5) == "false") {
-        it = it + 5;
-        temp_bool = false;
-    } else {
-        throw TOML::ParseError("Unable to parse as a boolean.");
+// Replace the escape sequences in a string body that has already been checked
+// by scan_string, writing the result to out, and return the length of the
+// result.  The result is never longer than the input, so out may be the same
+// as begin (decoding in place).
+static std::size_t unescape_string(string_it begin, const string_it end,
+        char* out) {
+    char* start = out;
+    while (begin != end) {
+        // Copy the run up to the next escape in one go (an unescaped '"'
+        // cannot appear in a checked body).  When decoding in place the
+        // ranges may overlap.
+        string_it run_end = find_quote_or_backslash(begin, end);
+        if (out != begin) {
+            std::memmove(out, begin, run_end - begin);
+        }
+        out += run_end - begin;
+        begin = run_end;
+        if (begin == end) {
+            break;
+        }
+        begin++;
+        switch (*begin) {
+            case 'b': *out = '\b'; break;
+            case 't': *out = '\t'; break;
+            case 'n': *out = '\n'; break;
+            case 'f': *out = '\f'; break;
+            case 'r': *out = '\r'; break;
+            default:  *out = *begin; break;  // '"' or '\\'
+        }
+        out++;
+        begin++;
     }
-    return temp_bool;
+    return out - start;
 }
 
 // ----------------------------------------------------------------------------
 
-// Attempt to parse the value as a number.  Return the Number or raise a
-// ParseError if parsing fails.
-// TODO -- handle underscore separators
-TOML::Number TOML::Value::parse_number(
-        string_it& it, const string_it& end) {
-    TOML::Number temp_number;
-    temp_number.valid_integer = false;
-    temp_number.integer_value = 0;
-    temp_number.valid_float = false;
-    temp_number.float_value = 0.0;
+// Advance the iterator across a number, checking its syntax (sign, integer
+// part, decimal part, and exponent) but not working out its value.  Raise a
+// ParseError if the number is malformed.
+static void scan_number(string_it& it, const string_it& end) {
     // sign
-    TOML::Integer sign;
-    if (*it == '-') {
-        sign = -1;
-        it++;
-    } else if (*it == '+') {
-        sign = 1;
+    if (it == end) {
+        throw TOML::ParseError("Unable to parse as a number.");
+    } else if (*it == '-' || *it == '+') {
         it++;
-    } else if (*it == '.' || is_digit(*it)) {
-        sign = 1;
-    } else {
+    } else if (*it != '.' && !is_digit(*it)) {
         throw TOML::ParseError("Unable to parse as a number.");
     }
     // integer part
-    TOML::Integer ipart = 0;
     while (it != end && is_digit(*it)) {
-        ipart = 10 * ipart + to_digit(*it);
         it++;
     }
     // decimal
-    TOML::Float dpart = 0;
-    TOML::Float shift = 0.1;
     if (it != end && *it == '.') {
         it++;
         while (it != end && is_digit(*it)) {
-            dpart += shift * to_digit(*it);
-            shift *= 0.1;
             it++;
         }
     }
     // exponent (scientific notation)
-    TOML::Integer e_sign;
-    TOML::Integer exponent = 0;
     if (it != end && (*it == 'e' || *it == 'E')) {
         it++;
-        if (*it == '-') {
-            e_sign = -1;
-            it++;
-        } else if (*it == '+') {
-            e_sign = 1;
+        if (it == end) {
+            throw TOML::ParseError("Invalid exponent in number.");
+        } else if (*it == '-' || *it == '+') {
             it++;
-        } else if (is_digit(*it)) {
-            e_sign = 1;
-        } else {
+        } else if (!is_digit(*it)) {
             throw TOML::ParseError("Invalid exponent in number.");
         }
         while (it != end && is_digit(*it)) {
-            exponent = 10 * exponent + to_digit(*it);
             it++;
         }
-        exponent *= e_sign;
-    }
-    // Construct the number
-    if (dpart == 0 && exponent == 0) {
-        // This is really an integer, and may also be a float
-        TOML::Integer as_integer = sign * ipart;
-        TOML::Float as_float = static_cast<TOML::Float>(as_integer);
-        if (as_integer == as_float) {
-            temp_number.float_value = as_float;
-            temp_number.valid_float = true;
-        }
-        temp_number.integer_value = as_integer;
-        temp_number.valid_integer = true;
-    } else {
-        // This is really a float, and may also be an integer
-        TOML::Float as_float = sign *
-            (static_cast<TOML::Float>(ipart) + dpart) *
-            std::pow(10.0, exponent);
-        TOML::Integer as_integer = static_cast<TOML::Integer>(as_float);
-        if (as_float == as_integer) {
-            temp_number.integer_value = as_integer;
-            temp_number.valid_integer = true;
-        }
-        temp_number.float_value = as_float;
-        temp_number.valid_float = true;
     }
-    return temp_number;
 }
 
 // ----------------------------------------------------------------------------
 
-// Analyze the given input string.  If it is a valid value, set the Value to
-// have the appropriate internal values and flags.  Otherwise, raise a
-// ParseError.
-void TOML::Value::analyze(string_it& it, const string_it& end) {
-    // Clear the current internal values and flags
-    clear();
-
-    // Trim leading whitespace
-    consume_whitespace(it, end);
-
-    // Ensure there is something (non-comment) left in the string
-    if (it == end || *it == '#') {
-        throw TOML::ParseError("Empty value.");
-    }
-
-    // Choose which type to parse
-    if (*it == '"') {
-        // This is either a String or nothing
-        TOML::String temp_string = parse_string(it, end);
-        // Save it
-        value_as_string = temp_string;
-        is_conformable_to_string = true;
-    } else if (*it == 't' || *it == 'f') {
-        // This is either a Boolean or nothing
-        TOML::Boolean temp_boolean = parse_boolean(it, end);
-        // Save it
-        value_as_boolean = temp_boolean;
-        is_conformable_to_boolean = true;
-    } else if (*it == '-' || *it == '+' || *it == '.' ||
-            is_digit(*it)) {
-        // This is either an Integer, a Float, both, or nothing
-        TOML::Number temp_number = parse_number(it, end);
-        // Save it
-        value_as_integer = temp_number.integer_value;
-        value_as_float = temp_number.float_value;
-        is_conformable_to_integer = temp_number.valid_integer;
-        is_conformable_to_float = temp_number.valid_float;
+// Advance the iterator across "true" or "false" and return which it was, or
+// raise a ParseError
+static bool scan_boolean(string_it& it, const string_it& end) {
+    if (end - it >= 4 && std::memcmp(it, "true", 4) == 0) {
+        it += 4;
+        return true;
+    } else if (end - it >= 5 && std::memcmp(it, "false", 5) == 0) {
+        it += 5;
+        return false;
     } else {
-        // This is nothing
-        throw TOML::ParseError("Unable to parse \"" + std::string(it,end) +
-                "\" to a value.");
+        throw TOML::ParseError("Unable to parse as a boolean.");
     }
 }
 
 // ----------------------------------------------------------------------------
 
-// Construct an empty Value
-// -- note: yes, an initialization list would be slightly more efficient.  But
-//    considering all my internal data is basic types, the performance
-//    difference is, for all intents and purposes, zero.  This is easier to
-//    write and to maintain.
-TOML::Value::Value() {
-    clear();
-}
+// A token on a line.  For a STRING the range is the body between the quotes
+// (with escape sequences still in place); for anything that is not a token
+// (INVALID) it is the rest of the line.
+struct TOML::Token {
+    enum Type {
+        END_OF_LINE, COMMENT, LEFT_BRACKET, RIGHT_BRACKET, DOT, EQUALS,
+        COMMA, BARE_KEY, STRING, NUMBER, BOOLEAN, INVALID
+    };
+    Type type;
+    string_it begin;
+    string_it end;
+    bool escaped;  // Does a STRING contain escape sequences?
+    bool boolean;  // The value of a BOOLEAN
+
+    // The first character of the token, as it appears on the line (or the
+    // comment character for the end of the line)
+    char first() const {
+        if (type == END_OF_LINE) {
+            return TOML::Table::comment;
+        }
+        return (type == STRING) ? '"' : *begin;
+    }
+};
 
 // ----------------------------------------------------------------------------
 
-// Construct a Value by analyzing an input string
-TOML::Value::Value(const std::string input_string) {
-    string_it it = input_string.begin();
-    analyze(it, input_string.end());
-}
+// Split a line into Tokens
+class Tokenizer {
+    private:
+        string_it it;
+        const string_it end;
+
+    public:
+        // Keys are expected before the '=' and in Table names; Values after
+        // the '='
+        enum Mode { KEY, VALUE };
+
+        Tokenizer(const string_it begin, const string_it end):
+            it(begin), end(end)
+        {}
+
+        // Where the next Token starts (or the blanks before it)
+        string_it position() const { return it; }
+        string_it line_end() const { return end; }
+
+        // Read the next Token.  Malformed Values raise a ParseError; a
+        // malformed quoted key is INVALID, so that the caller can say what
+        // was expected there.
+        TOML::Token next(const Mode mode) {
+            it = skip_blanks(it, end);
+            const string_it start = it;
+            TOML::Token token;
+            token.begin = it;
+            token.escaped = false;
+            token.boolean = false;
+            if (it == end) {
+                token.type = TOML::Token::END_OF_LINE;
+                token.end = end;
+                return token;
+            }
+            switch (*it) {
+                case TOML::Table::comment:
+                    token.type = TOML::Token::COMMENT;
+                    it = end;
+                    break;
+                case '[': token.type = TOML::Token::LEFT_BRACKET; it++; break;
+                case ']': token.type = TOML::Token::RIGHT_BRACKET; it++; break;
+                case ',': token.type = TOML::Token::COMMA; it++; break;
+                case '"':
+                    token.type = TOML::Token::STRING;
+                    if (mode == VALUE) {
+                        token.escaped = scan_string(it, end, token.begin,
+                                token.end);
+                        return token;
+                    }
+                    try {
+                        token.escaped = scan_string(it, end, token.begin,
+                                token.end);
+                    } catch (TOML::ParseError& pe) {
+                        token.type = TOML::Token::INVALID;
+                        token.begin = it = start;
+                        token.end = end;
+                    }
+                    return token;
+                default:
+                    if (mode == KEY && *it == '.') {
+                        token.type = TOML::Token::DOT;
+                        it++;
+                    } else if (mode == KEY && *it == '=') {
+                        token.type = TOML::Token::EQUALS;
+                        it++;
+                    } else if (mode == KEY && has_class(*it, BARE_KEY)) {
+                        token.type = TOML::Token::BARE_KEY;
+                        while (it != end && has_class(*it, BARE_KEY)) {
+                            it++;
+                        }
+                    } else if (mode == VALUE && (*it == 't' || *it == 'f')) {
+                        token.type = TOML::Token::BOOLEAN;
+                        token.boolean = scan_boolean(it, end);
+                    } else if (mode == VALUE &&
+                            has_class(*it, NUMBER_START)) {
+                        token.type = TOML::Token::NUMBER;
+                        scan_number(it, end);
+                    } else {
+                        token.type = TOML::Token::INVALID;
+                        token.end = end;
+                        return token;
+                    }
+                    break;
+            }
+            token.end = it;
+            return token;
+        }
 
-// ----------------------------------------------------------------------------
+        // Read a key (bare or quoted) and return it, or raise a ParseError
+        std::string key() {
+            return key(next(KEY));
+        }
 
-// Construct a Value by analyzing an input string from iterators
-TOML::Value::Value(string_it& it, const string_it& end) {
-    analyze(it, end);
-}
+        // Return the key that a Token read in KEY mode holds, or raise a
+        // ParseError
+        static std::string key(const TOML::Token& token) {
+            if (token.type == TOML::Token::BARE_KEY) {
+                return std::string(token.begin, token.end);
+            } else if (token.type == TOML::Token::STRING) {
+                std::string key(token.end - token.begin, '\0');
+                key.resize(unescape_string(token.begin, token.end, &key[0]));
+                if (key.empty()) {
+                    throw TOML::ParseError("Cannot have an empty quoted key.");
+                }
+                return key;
+            } else if (token.type == TOML::Token::INVALID &&
+                    *token.begin == '"') {
+                throw TOML::ParseError("Could not parse quoted key.");
+            } else {
+                throw TOML::ParseError("Empty bare key.");
+            }
+        }
 
-// ----------------------------------------------------------------------------
+        // Raise a ParseError unless the Token is the expected punctuation
+        static void expect(const TOML::Token& token, const char c) {
+            if (token.type == TOML::Token::END_OF_LINE) {
+                throw TOML::ParseError("No character to consume.");
+            } else if (token.first() != c) {
+                std::string message = "Consume character mismatch: '";
+                message.append(1, c);
+                message.append("' != '");
+                message.append(1, token.first());
+                message.append("'.");
+                throw TOML::ParseError(message);
+            }
+        }
 
-// Set the Value by analyzing an input string
-void TOML::Value::set_from_string(const std::string input_string) {
-    string_it it = input_string.begin();
-    analyze(it, input_string.end());
-}
+        // Raise a ParseError unless there is nothing left on the line but
+        // blanks and a comment
+        void expect_end() {
+            it = skip_blanks(it, end);
+            if (it != end && *it != TOML::Table::comment) {
+                std::string message = "Consume character mismatch: '";
+                message.append(1, TOML::Table::comment);
+                message.append("' != '");
+                message.append(1, *it);
+                message.append("'.");
+                throw TOML::ParseError(message);
+            }
+            it = end;
+        }
+};
 
-// ----------------------------------------------------------------------------
+// ============================================================================
+// Number conversion
+//
+// Decimal text is turned into a Float in three stages, each used only when
+// the one before cannot decide the answer:
+//   1. Clinger's fast path: a mantissa of at most 53 bits scaled by an exactly
+//      representable power of ten is a single correctly rounded operation.
+//   2. The Eisel-Lemire algorithm: multiply the mantissa by a 128-bit
+//      approximation of the power of ten and round, which is exact except in
+//      rare near-halfway cases that it can detect.
+//   3. An exact comparison of the decimal against the halfway points around a
+//      candidate Float, using arbitrary-precision integers.
+
+// A small arbitrary-precision unsigned integer, stored as 32-bit limbs with
+// the least significant limb first.  It only provides what the conversions
+// need.
+class BigInt {
+    private:
+        std::vector<std::uint32_t> limbs;
+
+        // Drop leading zero limbs, so that comparisons can go by size
+        void trim() {
+            while (!limbs.empty() && limbs.back() == 0) {
+                limbs.pop_back();
+            }
+        }
 
-// Set the Value from a String
-void TOML::Value::set(const TOML::String s) {
-    clear();
-    value_as_string = s;
-    is_conformable_to_string = true;
-}
+    public:
+        BigInt() {}
 
-// ----------------------------------------------------------------------------
+        explicit BigInt(const std::uint64_t value) {
+            limbs.push_back(static_cast<std::uint32_t>(value));
+            limbs.push_back(static_cast<std::uint32_t>(value >> 32));
+            trim();
+        }
 
-// Set the Value from an Integer (may also be conformable to a Float)
-void TOML::Value::set(const TOML::Integer i) {
-    clear();
-    value_as_integer = i;
-    is_conformable_to_integer = true;
-    TOML::Float temp_float = static_cast<TOML::Float>(i);
-    if (temp_float == i) {
-        value_as_float = temp_float;
-        is_conformable_to_float = true;
-    }
-}
+        // Multiply by a small number and then add a small number
+        void multiply_add(const std::uint32_t factor,
+                const std::uint32_t addend = 0) {
+            std::uint64_t carry = addend;
+            for (std::size_t i = 0; i < limbs.size(); i++) {
+                carry += static_cast<std::uint64_t>(limbs[i]) * factor;
+                limbs[i] = static_cast<std::uint32_t>(carry);
+                carry >>= 32;
+            }
+            if (carry != 0) {
+                limbs.push_back(static_cast<std::uint32_t>(carry));
+            }
+        }
+
+        // Divide by a small number, discarding the remainder
+        void divide(const std::uint32_t divisor) {
+            std::uint64_t remainder = 0;
+            for (std::size_t i = limbs.size(); i-- > 0; ) {
+                remainder = (remainder << 32) | limbs[i];
+                limbs[i] = static_cast<std::uint32_t>(remainder / divisor);
+                remainder %= divisor;
+            }
+            trim();
+        }
+
+        // Multiply by 5^n
+        void multiply_pow5(unsigned n) {
+            // 5^13 is the largest power of five that fits in 32 bits
+            while (n >= 13) {
+                multiply_add(1220703125u);
+                n -= 13;
+            }
+            std::uint32_t factor = 1;
+            while (n-- > 0) {
+                factor *= 5;
+            }
+            multiply_add(factor);
+        }
+
+        // Multiply by 2^n
+        void shift_left(const unsigned n) {
+            if (limbs.empty()) {
+                return;
+            }
+            const unsigned words = n / 32;
+            const unsigned bits = n % 32;
+            if (bits != 0) {
+                std::uint32_t carry = 0;
+                for (std::size_t i = 0; i < limbs.size(); i++) {
+                    std::uint32_t limb = limbs[i];
+                    limbs[i] = (limb << bits) | carry;
+                    carry = limb >> (32 - bits);
+                }
+                if (carry != 0) {
+                    limbs.push_back(carry);
+                }
+            }
+            limbs.insert(limbs.begin(), words, 0);
+        }
+
+        // The number of significant bits
+        unsigned bit_length() const {
+            if (limbs.empty()) {
+                return 0;
+            }
+            unsigned length = 32 * (limbs.size() - 1);
+            for (std::uint32_t top = limbs.back(); top != 0; top >>= 1) {
+                length++;
+            }
+            return length;
+        }
+
+        // The 64 bits starting at the given bit position (which may be
+        // negative, in which case zeros are shifted in at the bottom)
+        std::uint64_t bits64(const int start) const {
+            std::uint64_t result = 0;
+            for (int i = 63; i >= 0; i--) {
+                const int position = start + i;
+                result <<= 1;
+                if (position >= 0 &&
+                        static_cast<std::size_t>(position / 32) <
+                        limbs.size()) {
+                    result |= (limbs[position / 32] >> (position % 32)) & 1;
+                }
+            }
+            return result;
+        }
+
+        // The value divided by 2^n (rounding down)
+        BigInt shifted_right(const unsigned n) const {
+            BigInt result;
+            const unsigned length = bit_length();
+            for (unsigned start = n; start < length; start += 64) {
+                std::uint64_t chunk = bits64(start);
+                result.limbs.push_back(static_cast<std::uint32_t>(chunk));
+                result.limbs.push_back(
+                        static_cast<std::uint32_t>(chunk >> 32));
+            }
+            result.trim();
+            return result;
+        }
+
+        // Three-way comparison
+        static int compare(const BigInt& a, const BigInt& b) {
+            if (a.limbs.size() != b.limbs.size()) {
+                return (a.limbs.size() < b.limbs.size()) ? -1 : 1;
+            }
+            for (std::size_t i = a.limbs.size(); i-- > 0; ) {
+                if (a.limbs[i] != b.limbs[i]) {
+                    return (a.limbs[i] < b.limbs[i]) ? -1 : 1;
+                }
+            }
+            return 0;
+        }
+};
 
 // ----------------------------------------------------------------------------
 
-// Set the Value from a Float (may also be conformable to an Integer)
-void TOML::Value::set(const TOML::Float f) {
-    clear();
-    value_as_float = f;
-    is_conformable_to_float = true;
-    TOML::Integer temp_integer = static_cast<TOML::Integer>(f);
-    if (temp_integer == f) {
-        value_as_integer = temp_integer;
-        is_conformable_to_integer = true;
+// The range of decimal exponents covered by the power-of-five table.  Below
+// the smallest, every mantissa of up to 19 digits rounds to zero; above the
+// largest, every mantissa rounds to infinity.
+static const int smallest_power_of_ten = -342;
+static const int largest_power_of_ten = 308;
+
+// The 128-bit normalized approximations of 5^q used by Eisel-Lemire, stored
+// as (high, low) pairs for q from smallest_power_of_ten up to
+// largest_power_of_ten.  Positive powers are truncated to their top 128 bits
+// and negative powers are reciprocals rounded up, exactly as in the published
+// algorithm.  The table is worked out once, on first use, rather than
+// written out as about ten kilobytes of hexadecimal constants.
+static std::vector<std::uint64_t> make_powers_of_five() {
+    const int count = largest_power_of_ten - smallest_power_of_ten + 1;
+    std::vector<std::uint64_t> entries(2 * count);
+    // Non-negative powers: the top 128 bits of 5^q
+    BigInt power(1);
+    for (int q = 0; q <= largest_power_of_ten; q++) {
+        const int top = power.bit_length();
+        const int index = 2 * (q - smallest_power_of_ten);
+        entries[index] = power.bits64(top - 64);
+        entries[index + 1] = power.bits64(top - 128);
+        power.multiply_add(5);
+    }
+    // Negative powers: floor(2^b / 5^-q) + 1, trimmed to 128 bits, where b
+    // depends on the size of 5^-q.  Each quotient comes from a single huge
+    // power of two, using floor(floor(x / m) / n) == floor(x / (m n)).
+    const unsigned huge = 1800;
+    BigInt quotient(1);
+    quotient.shift_left(huge);
+    power = BigInt(1);
+    for (int q = -1; q >= smallest_power_of_ten; q--) {
+        quotient.divide(5);
+        power.multiply_add(5);
+        const unsigned z = power.bit_length();
+        const unsigned b = (q >= -27) ? z + 127 : 2 * z + 128;
+        BigInt c = quotient.shifted_right(huge - b);
+        c.multiply_add(1, 1);
+        const int top = c.bit_length();
+        const int bottom = (top > 128) ? top - 128 : 0;
+        const int index = 2 * (q - smallest_power_of_ten);
+        entries[index] = c.bits64(bottom + 64);
+        entries[index + 1] = c.bits64(bottom);
     }
+    return entries;
+}
+
+static const std::uint64_t* powers_of_five() {
+    static const std::vector<std::uint64_t> table = make_powers_of_five();
+    return table.data();
 }
 
 // ----------------------------------------------------------------------------
 
-// Set the Value from a Boolean
-void TOML::Value::set(const TOML::Boolean b) {
-    clear();
-    value_as_boolean = b;
-    is_conformable_to_boolean = true;
+// The full 128-bit product of two 64-bit numbers
+static std::uint64_t multiply_128(const std::uint64_t a, const std::uint64_t b,
+        std::uint64_t& high) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    high = static_cast<std::uint64_t>(product >> 64);
+    return static_cast<std::uint64_t>(product);
+#else
+    const std::uint64_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+    const std::uint64_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+    const std::uint64_t lo_lo = a_lo * b_lo;
+    const std::uint64_t hi_lo = a_hi * b_lo;
+    const std::uint64_t lo_hi = a_lo * b_hi;
+    const std::uint64_t hi_hi = a_hi * b_hi;
+    const std::uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+    high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    return (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+#endif
 }
 
 // ----------------------------------------------------------------------------
 
-// Return the Value as a String
-TOML::String TOML::Value::as_string() const {
-    if (is_conformable_to_string) {
-        return value_as_string;
-    } else {
-        throw TOML::TypeError("Value cannot be converted to a string.");
+// Count the leading zero bits of a nonzero number
+static int leading_zeros(std::uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int count = 0;
+    while ((x & (static_cast<std::uint64_t>(1) << 63)) == 0) {
+        x <<= 1;
+        count++;
     }
+    return count;
+#endif
 }
 
 // ----------------------------------------------------------------------------
 
-// Return the Value as an Integer
-TOML::Integer TOML::Value::as_integer() const {
-    if (is_conformable_to_integer) {
-        return value_as_integer;
-    } else {
-        throw TOML::TypeError("Value cannot be converted to an integer.");
-    }
+// Reinterpret the bits of a (non-negative) Float, and back again
+static std::uint64_t float_bits(const TOML::Float f) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static TOML::Float bits_float(const std::uint64_t bits) {
+    TOML::Float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
 }
 
 // ----------------------------------------------------------------------------
 
-// Return the Value as a Float
-TOML::Float TOML::Value::as_float() const {
-    if (is_conformable_to_float) {
-        return value_as_float;
-    } else {
-        throw TOML::TypeError("Value cannot be converted to an integer.");
+// Work out the bits of the Float nearest to w * 10^q with the Eisel-Lemire
+// algorithm.  The result is always within one unit in the last place; return
+// whether it is certainly the correctly rounded one.
+static bool eisel_lemire(std::uint64_t w, const int q, std::uint64_t& bits) {
+    const int mantissa_bits = 52;
+    const int infinite_power = 0x7FF;
+    if (w == 0 || q < smallest_power_of_ten) {
+        bits = 0;
+        return true;
     }
+    if (q > largest_power_of_ten) {
+        bits = static_cast<std::uint64_t>(infinite_power) << mantissa_bits;
+        return true;
+    }
+    const int lz = leading_zeros(w);
+    w <<= lz;
+    // Multiply by the high half of the power of five, and bring in the low
+    // half only if the bits that decide the rounding might be affected
+    const std::uint64_t* power = powers_of_five() +
+        2 * (q - smallest_power_of_ten);
+    std::uint64_t high;
+    std::uint64_t low = multiply_128(w, power[0], high);
+    const std::uint64_t precision_mask =
+        ~static_cast<std::uint64_t>(0) >> (mantissa_bits + 3);
+    if ((high & precision_mask) == precision_mask) {
+        std::uint64_t second_high;
+        multiply_128(w, power[1], second_high);
+        low += second_high;
+        if (second_high > low) {
+            high++;
+        }
+    }
+    bool certain = true;
+    if (low == ~static_cast<std::uint64_t>(0) && (q < -27 || q > 55)) {
+        // The truncated product might be just below a rounding boundary
+        certain = false;
+    }
+    const int upper_bit = static_cast<int>(high >> 63);
+    const int shift = upper_bit + 64 - mantissa_bits - 3;
+    std::uint64_t mantissa = high >> shift;
+    // floor(q * log2(10)) + 63, then biased
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upper_bit - lz + 1023;
+    if (power2 <= 0) {
+        // Subnormal (or zero)
+        if (-power2 + 1 >= 64) {
+            bits = 0;
+            return certain;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        power2 = (mantissa < (static_cast<std::uint64_t>(1) << mantissa_bits))
+            ? 0 : 1;
+        bits = (mantissa & ((static_cast<std::uint64_t>(1) << mantissa_bits)
+                    - 1)) | (static_cast<std::uint64_t>(power2) <<
+                mantissa_bits);
+        return certain;
+    }
+    // An exact halfway case rounds to even; it can only happen for small q
+    if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+            (mantissa << shift) == high) {
+        mantissa &= ~static_cast<std::uint64_t>(1);
+    }
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if (mantissa >= (static_cast<std::uint64_t>(2) << mantissa_bits)) {
+        mantissa = static_cast<std::uint64_t>(1) << mantissa_bits;
+        power2++;
+    }
+    mantissa &= ~(static_cast<std::uint64_t>(1) << mantissa_bits);
+    if (power2 >= infinite_power) {
+        power2 = infinite_power;
+        mantissa = 0;
+    }
+    bits = mantissa | (static_cast<std::uint64_t>(power2) << mantissa_bits);
+    return certain;
 }
 
 // ----------------------------------------------------------------------------
 
-// Return the Value as a Boolean
-TOML::Boolean TOML::Value::as_boolean() const {
-    if (is_conformable_to_boolean) {
-        return value_as_boolean;
+// Compare digits * 10^e10 against m * 2^e2 exactly
+static int compare_decimal(const BigInt& digits, const int e10,
+        const std::uint64_t m, const int e2) {
+    BigInt left = digits;
+    BigInt right(m);
+    int left_e2 = e10;
+    int right_e2 = e2;
+    if (e10 >= 0) {
+        left.multiply_pow5(e10);
     } else {
-        throw TOML::TypeError("Value cannot be converted to an boolean.");
+        right.multiply_pow5(-e10);
     }
+    const int common = (left_e2 < right_e2) ? left_e2 : right_e2;
+    left.shift_left(left_e2 - common);
+    right.shift_left(right_e2 - common);
+    return BigInt::compare(left, right);
 }
 
 // ----------------------------------------------------------------------------
 
-bool TOML::Value::is_valid_string() const {
-    return is_conformable_to_string;
-}
+// Find the correctly rounded Float for digits * 10^e10, starting from a guess
+// that is at most a few units in the last place away, by comparing the exact
+// decimal against the halfway points on either side of the guess
+static TOML::Float exact_decimal_to_float(const BigInt& digits, const int e10,
+        std::uint64_t guess) {
+    const std::uint64_t hidden_bit = static_cast<std::uint64_t>(1) << 52;
+    const std::uint64_t infinity = static_cast<std::uint64_t>(0x7FF) << 52;
+    if (guess >= infinity) {
+        guess = infinity - 1;
+    }
+    while (true) {
+        // guess == m * 2^e2
+        const int biased = static_cast<int>(guess >> 52);
+        std::uint64_t m = guess & (hidden_bit - 1);
+        int e2 = -1074;
+        if (biased != 0) {
+            m |= hidden_bit;
+            e2 = biased - 1075;
+        }
+        // Is the decimal above the halfway point to the next Float up?
+        int c = compare_decimal(digits, e10, 2 * m + 1, e2 - 1);
+        if (c > 0 || (c == 0 && (m & 1) != 0)) {
+            guess++;
+            if (guess == infinity) {
+                return bits_float(infinity);
+            }
+            continue;
+        }
+        if (guess == 0) {
+            return 0.0;
+        }
+        // Is the decimal below the halfway point to the next Float down?
+        // (At a power of two the gap below is half the size of the gap
+        // above.)
+        if (m == hidden_bit && biased > 1) {
+            c = compare_decimal(digits, e10, 4 * m - 1, e2 - 2);
+        } else {
+            c = compare_decimal(digits, e10, 2 * m - 1, e2 - 1);
+        }
+        if (c < 0 || (c == 0 && (m & 1) != 0)) {
+            guess--;
+            continue;
+        }
+        return bits_float(guess);
+    }
+}
 
 // ----------------------------------------------------------------------------
 
-bool TOML::Value::is_valid_integer() const {
-    return is_conformable_to_integer;
+// Convert a decimal to the nearest Float.  The first (up to) 19 significant
+// digits are in w, and the value is w * 10^q unless further nonzero digits
+// were dropped (truncated), in which case the full digits are re-read from
+// [digits_begin, digits_end) -- which holds the integer and decimal parts,
+// including the decimal point -- with the value being those digits times
+// 10^full_q.
+static TOML::Float decimal_to_float(const std::uint64_t w, const int q,
+        const bool truncated, string_it digits_begin,
+        const string_it digits_end, const int full_q) {
+    static const TOML::Float exact_powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+        1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const std::uint64_t max_exact = static_cast<std::uint64_t>(1) << 53;
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+    // Clinger's fast path (only when arithmetic is done in plain doubles)
+    if (!truncated && w <= max_exact) {
+        if (q >= -22 && q <= 22) {
+            TOML::Float f = static_cast<TOML::Float>(w);
+            return (q < 0) ? f / exact_powers[-q] : f * exact_powers[q];
+        }
+        if (q > 22 && q <= 22 + 15) {
+            // Move some of the power of ten into the mantissa
+            std::uint64_t scaled = w;
+            for (int i = 22; i < q && scaled <= max_exact; i++) {
+                scaled *= 10;
+            }
+            if (scaled <= max_exact) {
+                return static_cast<TOML::Float>(scaled) * exact_powers[22];
+            }
+        }
+    }
+#endif
+    std::uint64_t bits;
+    bool certain = eisel_lemire(w, q, bits);
+    if (certain && truncated) {
+        // The true value lies between w and w + 1; if both round the same
+        // way then so does everything in between
+        std::uint64_t upper_bits;
+        certain = eisel_lemire(w + 1, q, upper_bits) && upper_bits == bits;
+    }
+    if (certain) {
+        return bits_float(bits);
+    }
+    BigInt digits;
+    for (string_it it = digits_begin; it != digits_end; it++) {
+        if (*it != '.') {
+            digits.multiply_add(10, to_digit(*it));
+        }
+    }
+    return exact_decimal_to_float(digits, full_q, bits);
+}
+
+// ============================================================================
+// Number formatting
+//
+// Floats are written with the fewest significant digits that read back as
+// the same Float, found with the Ryu algorithm: the interval of decimals
+// that round to the Float is scaled by a 125-bit power of five, and digits
+// are removed while the interval still contains a shorter decimal.
+
+// The sizes of Ryu's power-of-five tables and the precision of their entries
+static const int pow5_inverse_count = 342;
+static const int pow5_count = 326;
+static const int pow5_inverse_bits = 125;
+static const int pow5_bits = 125;
+
+// ceil(log2(5^e)) (and 1 for e == 0)
+static int pow5_bit_length(const int e) {
+    return static_cast<int>((static_cast<std::uint32_t>(e) * 1217359) >> 19)
+        + 1;
+}
+
+// floor(log10(2^e)) and floor(log10(5^e))
+static std::uint32_t log10_pow2(const int e) {
+    return (static_cast<std::uint32_t>(e) * 78913) >> 18;
+}
+
+static std::uint32_t log10_pow5(const int e) {
+    return (static_cast<std::uint32_t>(e) * 732923) >> 20;
 }
 
 // ----------------------------------------------------------------------------
 
-bool TOML::Value::is_valid_float() const {
-    return is_conformable_to_float;
+// Ryu's tables, stored as (low, high) pairs: 5^i trimmed to its top 125 bits,
+// and floor(2^(bits(5^i) - 1 + 125) / 5^i) + 1.  Like the parsing table they
+// are worked out on first use.
+static std::vector<std::uint64_t> make_ryu_pow5(const bool inverse) {
+    std::vector<std::uint64_t> entries;
+    const unsigned huge = 1024;
+    BigInt quotient(1);
+    quotient.shift_left(huge);
+    BigInt power(1);
+    const int count = inverse ? pow5_inverse_count : pow5_count;
+    for (int i = 0; i < count; i++) {
+        const int length = power.bit_length();
+        if (inverse) {
+            BigInt c = quotient.shifted_right(
+                    huge - (length - 1 + pow5_inverse_bits));
+            c.multiply_add(1, 1);
+            entries.push_back(c.bits64(0));
+            entries.push_back(c.bits64(64));
+        } else {
+            const int shift = length - pow5_bits;
+            entries.push_back(power.bits64(shift));
+            entries.push_back(power.bits64(shift + 64));
+        }
+        power.multiply_add(5);
+        quotient.divide(5);
+    }
+    return entries;
+}
+
+static const std::uint64_t* ryu_pow5() {
+    static const std::vector<std::uint64_t> table = make_ryu_pow5(false);
+    return table.data();
+}
+
+static const std::uint64_t* ryu_pow5_inverse() {
+    static const std::vector<std::uint64_t> table = make_ryu_pow5(true);
+    return table.data();
 }
 
 // ----------------------------------------------------------------------------
 
-bool TOML::Value::is_valid_boolean() const {
-    return is_conformable_to_boolean;
+// How many times does 5 divide the value?
+static unsigned pow5_factor(std::uint64_t value) {
+    unsigned count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count;
 }
 
 // ----------------------------------------------------------------------------
 
-// Convert the Value to a std::string as if writing a new TOML file
-std::string TOML::Value::serialize() const {
-    if (is_conformable_to_boolean) {
-        // Write as a Boolean
-        if (value_as_boolean) {
-            return "true";
+// (m * mul) >> j, where mul is a 128-bit table entry and 64 < j < 128
+static std::uint64_t multiply_shift(const std::uint64_t m,
+        const std::uint64_t* mul, const int j) {
+    std::uint64_t high1;
+    const std::uint64_t low1 = multiply_128(m, mul[1], high1);
+    std::uint64_t high0;
+    multiply_128(m, mul[0], high0);
+    const std::uint64_t sum = high0 + low1;
+    if (sum < high0) {
+        high1++;
+    }
+    const int shift = j - 64;
+    return (high1 << (64 - shift)) | (sum >> shift);
+}
+
+// ----------------------------------------------------------------------------
+
+// Find the shortest decimal (digits * 10^exponent) that reads back as the
+// given finite, positive Float
+static void shortest_decimal(const TOML::Float f, std::uint64_t& digits,
+        int& exponent) {
+    const int mantissa_bits = 52;
+    const int bias = 1023;
+    const std::uint64_t bits = float_bits(f);
+    const std::uint64_t ieee_mantissa =
+        bits & ((static_cast<std::uint64_t>(1) << mantissa_bits) - 1);
+    const std::uint32_t ieee_exponent =
+        static_cast<std::uint32_t>(bits >> mantissa_bits);
+    // The Float is m2 * 2^e2, with two extra bits for the interval bounds
+    int e2;
+    std::uint64_t m2;
+    if (ieee_exponent == 0) {
+        e2 = 1 - bias - mantissa_bits - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = static_cast<int>(ieee_exponent) - bias - mantissa_bits - 2;
+        m2 = (static_cast<std::uint64_t>(1) << mantissa_bits) | ieee_mantissa;
+    }
+    // Reading rounds halfway cases to even, so an even Float owns the ends
+    // of its interval
+    const bool accept_bounds = (m2 & 1) == 0;
+    // The interval is [mm, mp] around mv, all scaled by 4; the gap below is
+    // half size at a power of two
+    const std::uint64_t mv = 4 * m2;
+    const std::uint32_t mm_shift = (ieee_mantissa != 0 || ieee_exponent <= 1);
+
+    // Scale the interval to a decimal exponent, remembering whether the
+    // digits dropped by the scaling were all zero
+    std::uint64_t vr, vp, vm;
+    int e10;
+    bool vm_trailing_zeros = false;
+    bool vr_trailing_zeros = false;
+    if (e2 >= 0) {
+        const std::uint32_t q = log10_pow2(e2) - (e2 > 3);
+        e10 = static_cast<int>(q);
+        const int k = pow5_inverse_bits + pow5_bit_length(q) - 1;
+        const int i = -e2 + static_cast<int>(q) + k;
+        const std::uint64_t* mul = ryu_pow5_inverse() + 2 * q;
+        vr = multiply_shift(4 * m2, mul, i);
+        vp = multiply_shift(4 * m2 + 2, mul, i);
+        vm = multiply_shift(4 * m2 - 1 - mm_shift, mul, i);
+        if (q <= 21) {
+            // Only one of mp, mv, and mm can be a multiple of 5, if any
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = pow5_factor(mv) >= q;
+            } else if (accept_bounds) {
+                vm_trailing_zeros = pow5_factor(mv - 1 - mm_shift) >= q;
+            } else {
+                vp -= (pow5_factor(mv + 2) >= q);
+            }
+        }
+    } else {
+        const std::uint32_t q = log10_pow5(-e2) - (-e2 > 1);
+        e10 = static_cast<int>(q) + e2;
+        const int i = -e2 - static_cast<int>(q);
+        const int k = pow5_bit_length(i) - pow5_bits;
+        const int j = static_cast<int>(q) - k;
+        const std::uint64_t* mul = ryu_pow5() + 2 * i;
+        vr = multiply_shift(4 * m2, mul, j);
+        vp = multiply_shift(4 * m2 + 2, mul, j);
+        vm = multiply_shift(4 * m2 - 1 - mm_shift, mul, j);
+        if (q <= 1) {
+            // mv = 4 * m2 always has at least two trailing zero bits
+            vr_trailing_zeros = true;
+            if (accept_bounds) {
+                vm_trailing_zeros = (mm_shift == 1);
+            } else {
+                vp--;
+            }
+        } else if (q < 63) {
+            vr_trailing_zeros =
+                (mv & ((static_cast<std::uint64_t>(1) << q) - 1)) == 0;
+        }
+    }
+
+    // Remove digits while the interval still holds a shorter decimal
+    int removed = 0;
+    unsigned last_removed = 0;
+    std::uint64_t output;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        // The general case (rare): track exact ties
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros = vm_trailing_zeros && vm % 10 == 0;
+            vr_trailing_zeros = vr_trailing_zeros && last_removed == 0;
+            last_removed = static_cast<unsigned>(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros = vr_trailing_zeros && last_removed == 0;
+                last_removed = static_cast<unsigned>(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+            // The exact value is ...50..0, so round to even
+            last_removed = 4;
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros))
+                || last_removed >= 5);
+    } else {
+        // The common case
+        bool round_up = false;
+        if (vp / 100 > vm / 100) {
+            round_up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    digits = output;
+    exponent = e10 + removed;
+}
+
+// ----------------------------------------------------------------------------
+
+// Write the digits of a number to the end of a buffer, returning the start
+static char* write_digits(std::uint64_t value, char* end) {
+    do {
+        *--end = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return end;
+}
+
+// ----------------------------------------------------------------------------
+
+// Format an Integer without going through a stream
+static std::string format_integer(const TOML::Integer i) {
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    // Negate in unsigned arithmetic, which also works for the most negative
+    // Integer
+    const std::uint64_t magnitude = (i < 0) ?
+        0 - static_cast<std::uint64_t>(i) : static_cast<std::uint64_t>(i);
+    char* begin = write_digits(magnitude, end);
+    if (i < 0) {
+        *--begin = '-';
+    }
+    return std::string(begin, end);
+}
+
+// ----------------------------------------------------------------------------
+
+// Format a Float with the fewest digits that read back exactly.  The layout
+// is that of the "%g" style that streams use: plain decimals for moderate
+// magnitudes and scientific notation (with a signed, two-digit or longer
+// exponent) for very large or small ones.
+static std::string format_float(const TOML::Float f) {
+    if (std::isnan(f)) {
+        return "nan";
+    } else if (std::isinf(f)) {
+        return (f < 0) ? "-inf" : "inf";
+    } else if (f == 0) {
+        return std::signbit(f) ? "-0" : "0";
+    }
+    std::uint64_t digits;
+    int exponent;
+    shortest_decimal(std::fabs(f), digits, exponent);
+    char digit_buffer[20];
+    char* const digits_end = digit_buffer + sizeof(digit_buffer);
+    const char* const digits_begin = write_digits(digits, digits_end);
+    const int count = static_cast<int>(digits_end - digits_begin);
+    // The power of ten of the leading digit
+    const int point = exponent + count - 1;
+
+    std::string output;
+    output.reserve(32);
+    if (f < 0) {
+        output += '-';
+    }
+    if (point < -4 || point >= 15) {
+        // d.ddde+XX
+        output += digits_begin[0];
+        if (count > 1) {
+            output += '.';
+            output.append(digits_begin + 1, count - 1);
+        }
+        output += 'e';
+        output += (point < 0) ? '-' : '+';
+        const int magnitude = (point < 0) ? -point : point;
+        if (magnitude < 10) {
+            output += '0';
+        }
+        char exponent_buffer[8];
+        char* exponent_end = exponent_buffer + sizeof(exponent_buffer);
+        const char* exponent_begin = write_digits(magnitude, exponent_end);
+        output.append(exponent_begin, exponent_end - exponent_begin);
+    } else if (point < 0) {
+        // 0.000ddd
+        output += "0.";
+        output.append(-point - 1, '0');
+        output.append(digits_begin, count);
+    } else if (point + 1 >= count) {
+        // ddd000
+        output.append(digits_begin, count);
+        output.append(point + 1 - count, '0');
+    } else {
+        // ddd.ddd
+        output.append(digits_begin, point + 1);
+        output += '.';
+        output.append(digits_begin + point + 1, count - point - 1);
+    }
+    return output;
+}
+
+// ============================================================================
+// Value ______________________________________________________________________
+
+// Clear the Value -- erase the internal value and set it to be nonconformable
+void TOML::Value::clear() {
+    // Give back the storage for a long String
+    if (has_text() && storage == HEAP) {
+        delete[] payload.text.data;
+    }
+    // Not conformable to anything
+    kind = EMPTY;
+    storage = INLINE;
+    inline_size = 0;
+    // Wipe the value
+    payload.integer = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+// Is a Float also conformable to an Integer (a whole number that fits in an
+// Integer)?
+static bool float_is_integer(const TOML::Float f) {
+    // The range check keeps the cast from being undefined behavior
+    return (f >= -9223372036854775808.0 && f < 9223372036854775808.0 &&
+            static_cast<TOML::Integer>(f) == f);
+}
+
+// ----------------------------------------------------------------------------
+
+// Does the Value hold text (a String, or the raw text of a lazy Value)?
+bool TOML::Value::has_text() const {
+    return (kind == STRING || kind == RAW_STRING || kind == RAW_NUMBER);
+}
+
+// ----------------------------------------------------------------------------
+
+// The characters of a String Value
+const char* TOML::Value::string_data() const {
+    if (storage == INLINE) {
+        return payload.inline_text;
+    } else {
+        return payload.text.data;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// The length of a String Value
+std::size_t TOML::Value::string_size() const {
+    if (storage == INLINE) {
+        return inline_size;
+    } else {
+        return payload.text.size;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Store a String.  Short strings are kept inline; longer strings are copied
+// into the Arena if one is given, or onto the heap otherwise.
+void TOML::Value::set_string(const char* data, const std::size_t size,
+        Arena* arena) {
+    clear();
+    if (size <= inline_capacity) {
+        std::memcpy(payload.inline_text, data, size);
+        inline_size = size;
+        storage = INLINE;
+    } else {
+        char* copy;
+        if (arena == nullptr) {
+            copy = new char[size];
+            storage = HEAP;
         } else {
-            return "false";
+            copy = static_cast<char*>(arena->allocate(size, 1));
+            storage = ARENA;
         }
-    } else if (is_conformable_to_integer) {
-        // Write as an Integer (anything conformable to both Integer and Float
-        // will appear as an Integer because Integers go before Floats)
-        std::stringstream ss;
-        ss << value_as_integer;
-        return ss.str();
-    } else if (is_conformable_to_float) {
-        // Write as a Float
-        std::stringstream ss;
-        ss << std::setprecision(15) << value_as_float;
-        return ss.str();
-    } else if (is_conformable_to_string) {
-        // Write as a String
-        string_it it = value_as_string.begin();
-        string_it end = value_as_string.end();
-        std::string output = "\""; // Surround with double-quotes
-        while (it != end) { // Fix escape sequences
-            if (*it == '"') {
-                output.append("\\\"");
-            } else if (*it == '\\') {
-                output.append("\\\\");
-            } else if (*it == '\b') {
-                output.append("\\b");
-            } else if (*it == '\t') {
-                output.append("\\t");
-            } else if (*it == '\n') {
-                output.append("\\n");
-            } else if (*it == '\f') {
-                output.append("\\f");
-            } else if (*it == '\r') {
-                output.append("\\r");
+        std::memcpy(copy, data, size);
+        payload.text.data = copy;
+        payload.text.size = size;
+    }
+    kind = STRING;
+}
+
+// ----------------------------------------------------------------------------
+
+// Work out the value of a number that has already been checked by
+// scan_number.  Integers are accumulated with an overflow check, and Floats
+// are correctly rounded (see "Number conversion" above).  An integer too big
+// for an Integer is still a valid Float.
+// TODO -- handle underscore separators
+TOML::Number TOML::Value::decode_number(string_it it, const string_it end) {
+    TOML::Number temp_number;
+    temp_number.valid_integer = false;
+    temp_number.integer_value = 0;
+    temp_number.valid_float = false;
+    temp_number.float_value = 0.0;
+    // sign
+    bool negative;
+    if (it == end) {
+        throw TOML::ParseError("Unable to parse as a number.");
+    } else if (*it == '-') {
+        negative = true;
+        it++;
+    } else if (*it == '+') {
+        negative = false;
+        it++;
+    } else if (*it == '.' || is_digit(*it)) {
+        negative = false;
+    } else {
+        throw TOML::ParseError("Unable to parse as a number.");
+    }
+    // The first 19 significant digits (which always fit in 64 bits) are
+    // gathered into w, with the decimal exponent adjusted to match; any
+    // further digits only matter if they are nonzero (truncated).
+    const int max_digits = 19;
+    std::uint64_t w = 0;
+    int w_digits = 0;
+    int q = 0;
+    bool truncated = false;
+    string_it digits_begin = it;
+    // integer part
+    const std::uint64_t max_magnitude =
+        std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t ipart = 0;
+    bool ipart_overflow = false;
+    while (it != end && is_digit(*it)) {
+        unsigned digit = to_digit(*it);
+        if (ipart > (max_magnitude - digit) / 10) {
+            ipart_overflow = true;
+        } else {
+            ipart = 10 * ipart + digit;
+        }
+        if (w_digits < max_digits) {
+            if (w != 0 || digit != 0) {
+                w = 10 * w + digit;
+                w_digits++;
+            }
+        } else {
+            truncated = truncated || digit != 0;
+            q++;
+        }
+        it++;
+    }
+    // decimal
+    bool dpart_zero = true;
+    int decimal_digits = 0;
+    if (it != end && *it == '.') {
+        it++;
+        while (it != end && is_digit(*it)) {
+            unsigned digit = to_digit(*it);
+            dpart_zero = dpart_zero && digit == 0;
+            if (w_digits < max_digits) {
+                if (w != 0 || digit != 0) {
+                    w = 10 * w + digit;
+                    w_digits++;
+                }
+                q--;
             } else {
-                output.append(1, *it);
+                truncated = truncated || digit != 0;
             }
+            decimal_digits++;
             it++;
         }
-        output += "\""; // Surround with double-quotes
-        return output;
+    }
+    string_it digits_end = it;
+    // exponent (scientific notation), saturated well beyond the range where
+    // every Float is zero or infinite
+    const int max_exponent = 1000000;
+    int exponent = 0;
+    if (it != end && (*it == 'e' || *it == 'E')) {
+        it++;
+        int e_sign;
+        if (it == end) {
+            throw TOML::ParseError("Invalid exponent in number.");
+        } else if (*it == '-') {
+            e_sign = -1;
+            it++;
+        } else if (*it == '+') {
+            e_sign = 1;
+            it++;
+        } else if (is_digit(*it)) {
+            e_sign = 1;
+        } else {
+            throw TOML::ParseError("Invalid exponent in number.");
+        }
+        while (it != end && is_digit(*it)) {
+            if (exponent < max_exponent) {
+                exponent = 10 * exponent + to_digit(*it);
+            }
+            it++;
+        }
+        exponent *= e_sign;
+    }
+    // Construct the number
+    if (dpart_zero && exponent == 0) {
+        // This is really an integer, and may also be a float.  The magnitude
+        // of the most negative Integer is one more than that of the most
+        // positive.
+        const std::uint64_t limit = negative ?
+            static_cast<std::uint64_t>(
+                    std::numeric_limits<TOML::Integer>::max()) + 1 :
+            static_cast<std::uint64_t>(
+                    std::numeric_limits<TOML::Integer>::max());
+        if (!ipart_overflow && ipart <= limit) {
+            TOML::Integer as_integer = negative ?
+                static_cast<TOML::Integer>(0 - ipart) :
+                static_cast<TOML::Integer>(ipart);
+            temp_number.integer_value = as_integer;
+            temp_number.valid_integer = true;
+            temp_number.float_value = static_cast<TOML::Float>(as_integer);
+            temp_number.valid_float = true;
+            return temp_number;
+        }
+        // Otherwise it is too big to be an Integer, but is still a Float
+    }
+    // This is really a float, and may also be an integer
+    TOML::Float as_float = decimal_to_float(w, q + exponent, truncated,
+            digits_begin, digits_end, exponent - decimal_digits);
+    if (negative) {
+        as_float = -as_float;
+    }
+    if (float_is_integer(as_float)) {
+        temp_number.integer_value = static_cast<TOML::Integer>(as_float);
+        temp_number.valid_integer = true;
+    }
+    temp_number.float_value = as_float;
+    temp_number.valid_float = true;
+    return temp_number;
+}
+
+// ----------------------------------------------------------------------------
+
+// Analyze the given input string.  If it is a valid value, set the Value to
+// have the appropriate internal values and flags.  Otherwise, raise a
+// ParseError.  If lazy is set, the syntax is checked but Strings and numbers
+// are kept as raw text to be decoded on their first read.
+void TOML::Value::analyze(string_it& it, const string_it& end,
+        const bool lazy) {
+    // Clear the current internal values and flags
+    clear();
+    Tokenizer tokens(it, end);
+    set_from_token(tokens.next(Tokenizer::VALUE), end, lazy);
+    it = tokens.position();
+}
+
+// ----------------------------------------------------------------------------
+
+// Set the Value from a Token read in VALUE mode, or raise a ParseError if the
+// Token is not a Value.  (The line end is for the error message.)
+void TOML::Value::set_from_token(const TOML::Token& token,
+        const string_it& end, const bool lazy) {
+    clear();
+    switch (token.type) {
+        case TOML::Token::END_OF_LINE:
+        case TOML::Token::COMMENT:
+            throw TOML::ParseError("Empty value.");
+        case TOML::Token::STRING:
+            if (lazy && token.escaped) {
+                // Keep the text between the quotes, to unescape later
+                set_string(token.begin, token.end - token.begin, nullptr);
+                kind = RAW_STRING;
+            } else if (!token.escaped) {
+                // There is nothing to unescape, so no temporary is needed
+                set_string(token.begin, token.end - token.begin, nullptr);
+            } else {
+                TOML::String temp_string(token.end - token.begin, '\0');
+                temp_string.resize(unescape_string(token.begin, token.end,
+                            &temp_string[0]));
+                set_string(temp_string.data(), temp_string.size(), nullptr);
+            }
+            break;
+        case TOML::Token::BOOLEAN:
+            payload.boolean = token.boolean;
+            kind = BOOLEAN;
+            break;
+        case TOML::Token::NUMBER:
+            if (lazy) {
+                // Keep the text of the number
+                set_string(token.begin, token.end - token.begin, nullptr);
+                kind = RAW_NUMBER;
+            } else {
+                // This is either an Integer, a Float, both, or nothing.  A
+                // number that is valid as both is stored as an Integer; its
+                // Float form is recovered exactly from that.
+                TOML::Number temp_number = decode_number(token.begin,
+                        token.end);
+                if (temp_number.valid_integer) {
+                    payload.integer = temp_number.integer_value;
+                    kind = INTEGER;
+                } else {
+                    payload.floating = temp_number.float_value;
+                    kind = FLOAT;
+                }
+            }
+            break;
+        default:
+            // This is nothing
+            throw TOML::ParseError("Unable to parse \"" +
+                    std::string(token.begin, end) + "\" to a value.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Decode a lazily-parsed Value on its first read, replacing the raw text with
+// the decoded value.  (The text was checked when it was parsed, so this
+// cannot fail.)
+void TOML::Value::decode() const {
+    if (kind == RAW_STRING) {
+        // Unescaping never makes the text longer, so it is done in place
+        char* data = (storage == INLINE) ? payload.inline_text :
+            payload.text.data;
+        std::size_t size = unescape_string(data, data + string_size(), data);
+        if (storage == INLINE) {
+            inline_size = size;
+        } else {
+            payload.text.size = size;
+        }
+        kind = STRING;
+    } else if (kind == RAW_NUMBER) {
+        TOML::Number temp_number = decode_number(string_data(),
+                string_data() + string_size());
+        if (storage == HEAP) {
+            delete[] payload.text.data;
+        }
+        storage = INLINE;
+        inline_size = 0;
+        if (temp_number.valid_integer) {
+            payload.integer = temp_number.integer_value;
+            kind = INTEGER;
+        } else {
+            payload.floating = temp_number.float_value;
+            kind = FLOAT;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct an empty Value
+TOML::Value::Value():
+    kind(EMPTY),
+    storage(INLINE),
+    inline_size(0)
+{
+    payload.integer = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a copy of a Value (a long String is copied onto the heap)
+TOML::Value::Value(const Value& v):
+    kind(EMPTY),
+    storage(INLINE),
+    inline_size(0)
+{
+    if (v.has_text()) {
+        set_string(v.string_data(), v.string_size(), nullptr);
+        kind = v.kind;
+    } else {
+        payload = v.payload;
+        kind = v.kind;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a Value by taking over the contents of another Value, which is
+// left empty
+TOML::Value::Value(Value&& v) noexcept:
+    kind(v.kind),
+    storage(v.storage),
+    inline_size(v.inline_size)
+{
+    payload = v.payload;
+    v.kind = EMPTY;
+    v.storage = INLINE;
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a copy of a Value whose String (if any) lives in the given Arena
+TOML::Value::Value(const Value& v, Arena* arena):
+    kind(EMPTY),
+    storage(INLINE),
+    inline_size(0)
+{
+    if (v.has_text()) {
+        set_string(v.string_data(), v.string_size(), arena);
+        kind = v.kind;
+    } else {
+        payload = v.payload;
+        kind = v.kind;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a Value that lives in the given Arena from a temporary.  Its
+// characters are taken over when both are on the heap, and copied otherwise.
+TOML::Value::Value(Value&& v, Arena* arena):
+    kind(EMPTY),
+    storage(INLINE),
+    inline_size(0)
+{
+    if (arena == nullptr && v.storage != ARENA) {
+        payload = v.payload;
+        kind = v.kind;
+        storage = v.storage;
+        inline_size = v.inline_size;
+        v.kind = EMPTY;
+        v.storage = INLINE;
+    } else if (v.has_text()) {
+        set_string(v.string_data(), v.string_size(), arena);
+        kind = v.kind;
+    } else {
+        payload = v.payload;
+        kind = v.kind;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+TOML::Value::~Value() {
+    clear();
+}
+
+// ----------------------------------------------------------------------------
+
+// Copy another Value into this one
+TOML::Value& TOML::Value::operator= (const Value& v) {
+    if (this != &v) {
+        if (v.has_text()) {
+            set_string(v.string_data(), v.string_size(), nullptr);
+            kind = v.kind;
+        } else {
+            clear();
+            payload = v.payload;
+            kind = v.kind;
+        }
+    }
+    return *this;
+}
+
+// ----------------------------------------------------------------------------
+
+// Take over the contents of another Value, which is left empty
+TOML::Value& TOML::Value::operator= (Value&& v) noexcept {
+    if (this != &v) {
+        clear();
+        payload = v.payload;
+        kind = v.kind;
+        storage = v.storage;
+        inline_size = v.inline_size;
+        v.kind = EMPTY;
+        v.storage = INLINE;
+    }
+    return *this;
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a Value by analyzing an input string
+TOML::Value::Value(const std::string input_string):
+    kind(EMPTY),
+    storage(INLINE),
+    inline_size(0)
+{
+    string_it it = input_string.data();
+    analyze(it, input_string.data() + input_string.size());
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a Value by analyzing an input string from iterators
+TOML::Value::Value(string_it& it, const string_it& end):
+    kind(EMPTY),
+    storage(INLINE),
+    inline_size(0)
+{
+    analyze(it, end);
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a Value by analyzing an input string from std::string iterators
+TOML::Value::Value(std::string::const_iterator& it,
+        const std::string::const_iterator& end):
+    kind(EMPTY),
+    storage(INLINE),
+    inline_size(0)
+{
+    analyze(it, end);
+}
+
+// ----------------------------------------------------------------------------
+
+// Analyze the input between two std::string iterators.  This forwards to the
+// pointer-based analyze and then moves the iterator by as many characters as
+// were consumed.
+void TOML::Value::analyze(std::string::const_iterator& it,
+        const std::string::const_iterator& end) {
+    string_it first = (it == end) ? nullptr : &*it;
+    string_it p = first;
+    try {
+        analyze(p, first + (end - it));
+    } catch (TOML::ParseError& pe) {
+        it += (p - first);
+        throw;
+    }
+    it += (p - first);
+}
+
+// ----------------------------------------------------------------------------
+
+// Set the Value by analyzing an input string
+void TOML::Value::set_from_string(const std::string input_string) {
+    string_it it = input_string.data();
+    analyze(it, input_string.data() + input_string.size());
+}
+
+// ----------------------------------------------------------------------------
+
+// Set the Value from a String
+void TOML::Value::set(const TOML::String s) {
+    set_string(s.data(), s.size(), nullptr);
+}
+
+// ----------------------------------------------------------------------------
+
+// Set the Value from an Integer (also conformable to a Float)
+void TOML::Value::set(const TOML::Integer i) {
+    clear();
+    payload.integer = i;
+    kind = INTEGER;
+}
+
+// ----------------------------------------------------------------------------
+
+// Set the Value from a Float (may also be conformable to an Integer)
+void TOML::Value::set(const TOML::Float f) {
+    clear();
+    payload.floating = f;
+    kind = FLOAT;
+}
+
+// ----------------------------------------------------------------------------
+
+// Set the Value from a Boolean
+void TOML::Value::set(const TOML::Boolean b) {
+    clear();
+    payload.boolean = b;
+    kind = BOOLEAN;
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the Value as a String
+TOML::String TOML::Value::as_string() const {
+    decode();
+    if (kind == STRING) {
+        return TOML::String(string_data(), string_size());
+    } else {
+        throw TOML::TypeError("Value cannot be converted to a string.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the Value as an Integer
+TOML::Integer TOML::Value::as_integer() const {
+    decode();
+    if (kind == INTEGER) {
+        return payload.integer;
+    } else if (kind == FLOAT && float_is_integer(payload.floating)) {
+        return static_cast<TOML::Integer>(payload.floating);
+    } else {
+        throw TOML::TypeError("Value cannot be converted to an integer.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the Value as a Float
+TOML::Float TOML::Value::as_float() const {
+    decode();
+    if (kind == FLOAT) {
+        return payload.floating;
+    } else if (kind == INTEGER) {
+        return static_cast<TOML::Float>(payload.integer);
+    } else {
+        throw TOML::TypeError("Value cannot be converted to an integer.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the Value as a Boolean
+TOML::Boolean TOML::Value::as_boolean() const {
+    decode();
+    if (kind == BOOLEAN) {
+        return payload.boolean;
+    } else {
+        throw TOML::TypeError("Value cannot be converted to an boolean.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// -- The lexical kind of a lazy Value is enough to answer this (and the Float
+//    and Boolean questions), so they do not need to decode it.
+bool TOML::Value::is_valid_string() const {
+    return (kind == STRING || kind == RAW_STRING);
+}
+
+// ----------------------------------------------------------------------------
+
+bool TOML::Value::is_valid_integer() const {
+    decode();
+    return (kind == INTEGER ||
+            (kind == FLOAT && float_is_integer(payload.floating)));
+}
+
+// ----------------------------------------------------------------------------
+
+bool TOML::Value::is_valid_float() const {
+    return (kind == FLOAT || kind == INTEGER || kind == RAW_NUMBER);
+}
+
+// ----------------------------------------------------------------------------
+
+bool TOML::Value::is_valid_boolean() const {
+    return (kind == BOOLEAN);
+}
+
+// ----------------------------------------------------------------------------
+
+// Convert the Value to a std::string as if writing a new TOML file
+std::string TOML::Value::serialize() const {
+    decode();
+    if (kind == BOOLEAN) {
+        // Write as a Boolean
+        if (payload.boolean) {
+            return "true";
+        } else {
+            return "false";
+        }
+    } else if (is_valid_integer()) {
+        // Write as an Integer (anything conformable to both Integer and Float
+        // will appear as an Integer because Integers go before Floats)
+        return format_integer(as_integer());
+    } else if (kind == FLOAT) {
+        // Write as a Float, with just enough digits to read back exactly
+        return format_float(payload.floating);
+    } else if (kind == STRING) {
+        // Write as a String
+        string_it it = string_data();
+        string_it end = it + string_size();
+        std::string output = "\""; // Surround with double-quotes
+        while (it != end) { // Fix escape sequences
+            if (*it == '"') {
+                output.append("\\\"");
+            } else if (*it == '\\') {
+                output.append("\\\\");
+            } else if (*it == '\b') {
+                output.append("\\b");
+            } else if (*it == '\t') {
+                output.append("\\t");
+            } else if (*it == '\n') {
+                output.append("\\n");
+            } else if (*it == '\f') {
+                output.append("\\f");
+            } else if (*it == '\r') {
+                output.append("\\r");
+            } else {
+                output.append(1, *it);
+            }
+            it++;
+        }
+        output += "\""; // Surround with double-quotes
+        return output;
+    } else {
+        // Not actually a valid Value
+        throw TOML::ValueError("Value cannot be serialized.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Write a Value to a stream
+std::ostream& TOML::operator<< (std::ostream& sout, const TOML::Value& v) {
+    sout << v.serialize();
+    return sout;
+}
+
+// ============================================================================
+// ValueArray _________________________________________________________________
+
+// Can an Integer be stored as a Float and read back unchanged?
+static bool integer_is_exact_float(const TOML::Integer i) {
+    return (i >= -9007199254740992LL && i <= 9007199254740992LL);
+}
+
+// ----------------------------------------------------------------------------
+
+TOML::ValueArray::ValueArray():
+    layout(EMPTY),
+    is_conformable_to_string(false),
+    is_conformable_to_integer(false),
+    is_conformable_to_float(false),
+    is_conformable_to_boolean(false)
+{}
+
+// ----------------------------------------------------------------------------
+
+// Construct an empty ValueArray whose Values will live in the given Arena
+TOML::ValueArray::ValueArray(Arena* arena):
+    layout(EMPTY),
+    array(ArenaAllocator<Value>(arena)),
+    integers(ArenaAllocator<Integer>(arena)),
+    floats(ArenaAllocator<Float>(arena)),
+    booleans(ArenaAllocator<Boolean>(arena)),
+    is_conformable_to_string(false),
+    is_conformable_to_integer(false),
+    is_conformable_to_float(false),
+    is_conformable_to_boolean(false)
+{}
+
+// ----------------------------------------------------------------------------
+
+// Construct a copy of a ValueArray that lives in the given Arena
+TOML::ValueArray::ValueArray(const ValueArray& va, Arena* arena):
+    layout(va.layout),
+    array(ArenaAllocator<Value>(arena)),
+    integers(va.integers.begin(), va.integers.end(),
+            ArenaAllocator<Integer>(arena)),
+    floats(va.floats.begin(), va.floats.end(),
+            ArenaAllocator<Float>(arena)),
+    booleans(va.booleans.begin(), va.booleans.end(),
+            ArenaAllocator<Boolean>(arena)),
+    is_conformable_to_string(va.is_conformable_to_string),
+    is_conformable_to_integer(va.is_conformable_to_integer),
+    is_conformable_to_float(va.is_conformable_to_float),
+    is_conformable_to_boolean(va.is_conformable_to_boolean)
+{
+    array.reserve(va.array.size());
+    for (auto it = va.array.begin(); it != va.array.end(); it++) {
+        array.emplace_back(*it, arena);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a ValueArray that lives in the given Arena from a temporary.  Its
+// storage is taken over when both are in the same place (the same Arena, or
+// the heap), and its elements are moved over one by one otherwise.
+TOML::ValueArray::ValueArray(ValueArray&& va, Arena* arena):
+    layout(va.layout),
+    array(ArenaAllocator<Value>(arena)),
+    integers(ArenaAllocator<Integer>(arena)),
+    floats(ArenaAllocator<Float>(arena)),
+    booleans(ArenaAllocator<Boolean>(arena)),
+    is_conformable_to_string(va.is_conformable_to_string),
+    is_conformable_to_integer(va.is_conformable_to_integer),
+    is_conformable_to_float(va.is_conformable_to_float),
+    is_conformable_to_boolean(va.is_conformable_to_boolean)
+{
+    if (va.arena() == arena) {
+        array.swap(va.array);
+        integers.swap(va.integers);
+        floats.swap(va.floats);
+        booleans.swap(va.booleans);
+    } else {
+        array.reserve(va.array.size());
+        for (auto it = va.array.begin(); it != va.array.end(); it++) {
+            array.emplace_back(std::move(*it), arena);
+        }
+        integers.assign(va.integers.begin(), va.integers.end());
+        floats.assign(va.floats.begin(), va.floats.end());
+        booleans.assign(va.booleans.begin(), va.booleans.end());
+        va.clear();
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned TOML::ValueArray::size() const {
+    switch (layout) {
+        case VALUES:
+            return array.size();
+        case INTEGERS:
+            return integers.size();
+        case FLOATS:
+            return floats.size();
+        case BOOLEANS:
+            return booleans.size();
+        default:
+            return 0;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Raise a ValueError unless the Value can be added, and narrow down the
+// formats the array is conformable to
+void TOML::ValueArray::check_type(const Value& v) {
+    if (size() == 0) {
+        is_conformable_to_string = v.is_valid_string();
+        is_conformable_to_integer = v.is_valid_integer();
+        is_conformable_to_float = v.is_valid_float();
+        is_conformable_to_boolean = v.is_valid_boolean();
+    } else if (is_conformable_to_string && v.is_valid_string()) {
+    } else if (is_conformable_to_integer && v.is_valid_integer()) {
+        is_conformable_to_float &= v.is_valid_float();
+    } else if (is_conformable_to_float && v.is_valid_float()) {
+        is_conformable_to_integer &= v.is_valid_integer();
+    } else if (is_conformable_to_boolean && v.is_valid_boolean()) {
+    } else {
+        throw TOML::ValueError(
+                "Value with invalid type cannot be added to ValueArray.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// The Arena the elements live in (nullptr for the heap)
+TOML::Arena* TOML::ValueArray::arena() const {
+    return array.get_allocator().arena;
+}
+
+// ----------------------------------------------------------------------------
+
+// Store a checked Value in the contiguous block it belongs in, changing the
+// layout when needed.  Return false when it has to be kept as a full Value
+// instead (the layout is then VALUES).
+bool TOML::ValueArray::add_native(const Value& v) {
+    if (size() == 0) {
+        layout = EMPTY;
+    }
+    if (v.kind == Value::RAW_NUMBER) {
+        v.decode();
+    }
+    if (v.kind == Value::INTEGER) {
+        if (layout == EMPTY) {
+            layout = INTEGERS;
+        }
+        if (layout == INTEGERS) {
+            integers.push_back(v.payload.integer);
+            return true;
+        } else if (layout == FLOATS &&
+                integer_is_exact_float(v.payload.integer)) {
+            floats.push_back(static_cast<Float>(v.payload.integer));
+            return true;
+        }
+    } else if (v.kind == Value::FLOAT) {
+        if (layout == EMPTY) {
+            layout = FLOATS;
+        } else if (layout == INTEGERS) {
+            to_floats();
+        }
+        if (layout == FLOATS) {
+            floats.push_back(v.payload.floating);
+            return true;
+        }
+    } else if (v.kind == Value::BOOLEAN) {
+        if (layout == EMPTY) {
+            layout = BOOLEANS;
+        }
+        if (layout == BOOLEANS) {
+            booleans.push_back(v.payload.boolean);
+            return true;
+        }
+    }
+    to_values();
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+// Move the Integers over to Floats, or to Values if one of them would not
+// convert exactly
+void TOML::ValueArray::to_floats() {
+    for (auto it = integers.begin(); it != integers.end(); it++) {
+        if (!integer_is_exact_float(*it)) {
+            to_values();
+            return;
+        }
+    }
+    floats.assign(integers.begin(), integers.end());
+    integers.clear();
+    integers.shrink_to_fit();
+    layout = FLOATS;
+}
+
+// ----------------------------------------------------------------------------
+
+// Move the elements over to full Values
+void TOML::ValueArray::to_values() {
+    if (layout != VALUES) {
+        const unsigned n = size();
+        array.reserve(n + 1);
+        for (unsigned i = 0; i < n; i++) {
+            array.emplace_back(at(i));
+        }
+        integers.clear();
+        integers.shrink_to_fit();
+        floats.clear();
+        floats.shrink_to_fit();
+        booleans.clear();
+        booleans.shrink_to_fit();
+        layout = VALUES;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void TOML::ValueArray::add(const Value& v) {
+    check_type(v);
+    if (!add_native(v)) {
+        array.emplace_back(v, arena());
+    }
+}
+
+void TOML::ValueArray::add(Value&& v) {
+    check_type(v);
+    if (!add_native(v)) {
+        array.emplace_back(std::move(v), arena());
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void TOML::ValueArray::remove(const unsigned index) {
+    if (index >= size()) {
+        throw std::out_of_range("Out-of-range index in ValueArray.");
+    }
+    switch (layout) {
+        case VALUES:
+            array.erase(array.begin()+index);
+            break;
+        case INTEGERS:
+            integers.erase(integers.begin()+index);
+            break;
+        case FLOATS:
+            floats.erase(floats.begin()+index);
+            break;
+        case BOOLEANS:
+            booleans.erase(booleans.begin()+index);
+            break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void TOML::ValueArray::clear() {
+    array.clear();
+    integers.clear();
+    floats.clear();
+    booleans.clear();
+    layout = EMPTY;
+}
+
+// ----------------------------------------------------------------------------
+
+TOML::Value TOML::ValueArray::at(const unsigned index) const {
+    if (index >= size()) {
+        throw std::out_of_range("Out-of-range index in ValueArray.");
+    }
+    TOML::Value v;
+    switch (layout) {
+        case INTEGERS:
+            v.set(integers[index]);
+            break;
+        case FLOATS:
+            v.set(floats[index]);
+            break;
+        case BOOLEANS:
+            v.set(booleans[index]);
+            break;
+        default:
+            v = array[index];
+            break;
+    }
+    return v;
+}
+
+// ----------------------------------------------------------------------------
+
+const TOML::Integer* TOML::ValueArray::integer_data() const {
+    return (layout == INTEGERS ? integers.data() : nullptr);
+}
+
+const TOML::Float* TOML::ValueArray::float_data() const {
+    return (layout == FLOATS ? floats.data() : nullptr);
+}
+
+const TOML::Boolean* TOML::ValueArray::boolean_data() const {
+    return (layout == BOOLEANS ? booleans.data() : nullptr);
+}
+
+// ----------------------------------------------------------------------------
+
+std::vector<TOML::String> TOML::ValueArray::as_string() const {
+    if (is_conformable_to_string) {
+        std::vector<TOML::String> v;
+        v.reserve(size());
+        for (unsigned i = 0; i < size(); i++) {
+            v.push_back(at(i).as_string());
+        }
+        return v;
+    } else {
+        throw TOML::TypeError("ValueArray cannot be converted to strings.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+std::vector<TOML::Integer> TOML::ValueArray::as_integer() const {
+    if (is_conformable_to_integer) {
+        if (layout == INTEGERS) {
+            return std::vector<TOML::Integer>(
+                    integers.begin(), integers.end());
+        }
+        std::vector<TOML::Integer> v;
+        v.reserve(size());
+        if (layout == FLOATS) {
+            // Conformable, so every Float is a whole number in range
+            for (auto it = floats.begin(); it != floats.end(); it++) {
+                v.push_back(static_cast<TOML::Integer>(*it));
+            }
+        } else {
+            for (auto it = array.begin(); it != array.end(); it++) {
+                v.push_back(it->as_integer());
+            }
+        }
+        return v;
+    } else {
+        throw TOML::TypeError("ValueArray cannot be converted to integers.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+std::vector<TOML::Float> TOML::ValueArray::as_float() const {
+    if (is_conformable_to_float) {
+        if (layout == FLOATS) {
+            return std::vector<TOML::Float>(floats.begin(), floats.end());
+        }
+        std::vector<TOML::Float> v;
+        v.reserve(size());
+        if (layout == INTEGERS) {
+            for (auto it = integers.begin(); it != integers.end(); it++) {
+                v.push_back(static_cast<TOML::Float>(*it));
+            }
+        } else {
+            for (auto it = array.begin(); it != array.end(); it++) {
+                v.push_back(it->as_float());
+            }
+        }
+        return v;
+    } else {
+        throw TOML::TypeError("ValueArray cannot be converted to floats.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+std::vector<TOML::Boolean> TOML::ValueArray::as_boolean() const {
+    if (is_conformable_to_boolean) {
+        if (layout == BOOLEANS) {
+            return std::vector<TOML::Boolean>(
+                    booleans.begin(), booleans.end());
+        }
+        std::vector<TOML::Boolean> v;
+        v.reserve(size());
+        for (auto it = array.begin(); it != array.end(); it++) {
+            v.push_back(it->as_boolean());
+        }
+        return v;
+    } else {
+        throw TOML::TypeError("ValueArray cannot be converted to booleans.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+std::string TOML::ValueArray::serialize() const {
+    std::stringstream ss("");
+    ss << "[";
+    if (size() != 0) {
+        ss << at(0);
+        for (unsigned i = 1; i < size(); i++) {
+            ss << ", " << at(i);
+        }
+    } else {
+        ss << " ";
+    }
+    ss << "]";
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------------
+
+// Write a ValueArray to a stream
+std::ostream& TOML::operator<< (
+        std::ostream& sout, const TOML::ValueArray& va) {
+    sout << va.serialize();
+    return sout;
+}
+
+// ============================================================================
+// Event parsing ______________________________________________________________
+
+// Reads lines and sends their events to a Handler.  (This is a class only so
+// that it can build Values straight from Tokens.)
+class TOML::LineParser {
+    public:
+        // Parse a single line (without its newline)
+        static void parse_line(string_it it, const string_it end,
+                Handler& handler, const ParseOptions& options) {
+            Tokenizer tokens(it, end);
+            Token token = tokens.next(Tokenizer::KEY);
+            // What kind of line is it?
+            if (token.type == Token::END_OF_LINE ||
+                    token.type == Token::COMMENT) {
+                // If the line is empty or is comment-only, skip it
+                return;
+            } else if (token.type == Token::LEFT_BRACKET) {
+                // This is the start of a new Table
+                std::vector<std::string> path;
+                path.push_back(tokens.key());
+                token = tokens.next(Tokenizer::KEY);
+                while (token.type == Token::DOT) {
+                    path.push_back(tokens.key());
+                    token = tokens.next(Tokenizer::KEY);
+                }
+                Tokenizer::expect(token, ']');
+                tokens.expect_end();
+                handler.on_table_header(path);
+            } else {
+                // This is a key pair
+                std::string key = Tokenizer::key(token);
+                Tokenizer::expect(tokens.next(Tokenizer::KEY), '=');
+                token = tokens.next(Tokenizer::VALUE);
+                if (token.type == Token::LEFT_BRACKET) {
+                    // This is a ValueArray
+                    handler.on_array_begin(key);
+                    token = tokens.next(Tokenizer::VALUE);
+                    while (token.type != Token::RIGHT_BRACKET) {
+                        Value v;
+                        v.set_from_token(token, end, options.lazy);
+                        handler.on_array_element(std::move(v));
+                        // (Only punctuation can follow, and KEY mode reads
+                        // anything else without raising its own error)
+                        token = tokens.next(Tokenizer::KEY);
+                        if (token.type == Token::COMMA) {
+                            token = tokens.next(Tokenizer::VALUE);
+                        } else if (token.type != Token::RIGHT_BRACKET) {
+                            throw ParseError("Malformed array of values.");
+                        }
+                    }
+                    tokens.expect_end();
+                    handler.on_array_end();
+                } else {
+                    // This is a Value
+                    Value v;
+                    v.set_from_token(token, end, options.lazy);
+                    tokens.expect_end();
+                    handler.on_key_value(key, std::move(v));
+                }
+            }
+        }
+};
+
+// ----------------------------------------------------------------------------
+
+// Parse a document from a buffer of characters [begin, end).  The lines are
+// parsed in place (they are not copied out of the buffer).
+void TOML::parse_buffer(const char* begin, const char* end, Handler& handler,
+        const ParseOptions& options) {
+    while (begin != end) {
+        // (The last line does not need a newline)
+        const char* eol = find_newline(begin, end);
+        LineParser::parse_line(begin, eol, handler, options);
+        begin = (eol == end) ? end : eol + 1;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a document from a string
+void TOML::parse_string(const std::string s, Handler& handler,
+        const ParseOptions& options) {
+    parse_buffer(s.data(), s.data() + s.size(), handler, options);
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a document from a stream, one line at a time
+void TOML::parse_stream(std::istream& sin, Handler& handler,
+        const ParseOptions& options) {
+    std::string line;
+    while(std::getline(sin,line)) {
+        LineParser::parse_line(line.data(), line.data() + line.size(),
+                handler, options);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a document from a file (specified by the file name)
+// -- The file is memory-mapped and handed to parse_buffer, so it is read once
+//    and never copied line by line.  If it cannot be mapped we fall back to
+//    parse_stream.
+void TOML::parse_file(const std::string filename, Handler& handler,
+        const ParseOptions& options) {
+    MappedFile file(filename);
+    if (file.begin() != nullptr) {
+        parse_buffer(file.begin(), file.end(), handler, options);
+        return;
+    }
+    // Open the file as a filestream and parse that stream
+    std::ifstream fin;
+    fin.open(filename);
+    parse_stream(fin, handler, options);
+    fin.close();    // Don't forget to close the file!
+}
+
+// ----------------------------------------------------------------------------
+
+// The Handler that the Table parse functions use: it builds the Table
+class TableBuilder : public TOML::Handler {
+    private:
+        TOML::Table& root;
+        TOML::Table* current_table;
+        std::string array_key;
+        TOML::ValueArray array;
+
+        // Keys may only be given once in each Table
+        void check_unique(const std::string& key) const {
+            if (current_table->has(key)) {
+                throw TOML::ParseError("Key \"" + key + "\" is not unique.");
+            }
+        }
+
+    public:
+        explicit TableBuilder(TOML::Table& root):
+            root(root),
+            current_table(&root)
+        {}
+
+        // The Table that keys are currently added to
+        TOML::Table& current() const { return *current_table; }
+
+        void on_table_header(const std::vector<std::string>& path) {
+            // The TOML standard does not allow re-entering a Table after
+            // you've already created it and then moved to another Table.
+            // Thus we generate an error if the Table already exists.
+            // TODO -- The TOML standard actually allows a slightly more
+            //         complex behavior: If you define Table [a.b], you can
+            //         then go back and fill in Table [a] so long as [a]
+            //         only exists because you built it as an intermediary
+            //         to build [a.b].  Thus I will need a more-complex
+            //         bookkeeping mechanism to specify whether a Table
+            //         exists because it was directly defined or because it
+            //         was built as an intermediary.
+            if (root.has(path)) {
+                std::string message = "Key \"";
+                for (unsigned index = 0; index < path.size()-1; index++) {
+                    message += path[index] + ".";
+                }
+                message += path[path.size()-1] + "\" is not unique.";
+                throw TOML::ParseError(message);
+            }
+            // Create the Table (and all intermediaries).  All paths are
+            // specified from the root Table.
+            current_table = &(root.get_table(path, true));
+        }
+
+        void on_key_value(const std::string& key, const TOML::Value& value) {
+            check_unique(key);
+            current_table->add(key, value);
+        }
+
+        void on_key_value(const std::string& key, TOML::Value&& value) {
+            check_unique(key);
+            current_table->add(key, std::move(value));
+        }
+
+        void on_array_begin(const std::string& key) {
+            check_unique(key);
+            array_key = key;
+            array = TOML::ValueArray();
+        }
+
+        void on_array_element(const TOML::Value& value) {
+            array.add(value);
+        }
+
+        void on_array_element(TOML::Value&& value) {
+            array.add(std::move(value));
+        }
+
+        void on_array_end() {
+            current_table->add(array_key, std::move(array));
+        }
+};
+
+// ----------------------------------------------------------------------------
+
+TOML::PushParser::PushParser(Handler& handler, const ParseOptions& options):
+    handler(&handler),
+    table(nullptr),
+    options(options)
+{}
+
+TOML::PushParser::PushParser(Table& table, const ParseOptions& options):
+    builder(new TableBuilder(table)),
+    table(&table),
+    options(options)
+{
+    handler = builder.get();
+    table.clear();
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse the whole lines in [begin, end) and keep the rest for later (or, at
+// the end of the input, parse the rest as the last line).  A line that was
+// started in an earlier chunk is finished off in the pending buffer; the lines
+// after it are parsed straight from the chunk.
+void TOML::PushParser::parse(const char* begin, const char* end,
+        const bool last) {
+    try {
+        const char* eol = find_newline(begin, end);
+        if (!pending.empty() && (eol != end || last)) {
+            pending.append(begin, eol - begin);
+            LineParser::parse_line(pending.data(),
+                    pending.data() + pending.size(), *handler, options);
+            pending.clear();
+            begin = (eol == end) ? end : eol + 1;
+            eol = find_newline(begin, end);
+        }
+        while (eol != end) {
+            LineParser::parse_line(begin, eol, *handler, options);
+            begin = eol + 1;
+            eol = find_newline(begin, end);
+        }
+        if (last) {
+            // (The last line does not need a newline)
+            if (begin != end) {
+                LineParser::parse_line(begin, end, *handler, options);
+            }
+        } else {
+            pending.append(begin, end - begin);
+        }
+    } catch (TOML::ParseError& pe) {
+        pending.clear();
+        if (table != nullptr) {
+            table->clear();
+        }
+        throw;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+void TOML::PushParser::feed(const char* data, const std::size_t size) {
+    parse(data, data + size, false);
+}
+
+// ----------------------------------------------------------------------------
+
+void TOML::PushParser::finish() {
+    // (An empty chunk, which must still point somewhere)
+    const char nothing = '\0';
+    parse(&nothing, &nothing, true);
+}
+
+// ============================================================================
+// Thread pool ________________________________________________________________
+
+// Runs tasks 0, 1, ..., count-1 on a number of threads (including this one).
+// Each thread starts with a contiguous share of the tasks and takes them from
+// the front; a thread that runs out steals the back half of another thread's
+// share.  Tasks must not throw.
+class TaskPool {
+    private:
+        // A share of the tasks: [begin, end)
+        struct Share {
+            std::mutex lock;
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        std::vector<Share> shares;
+        const std::function<void(std::size_t)> task;
+
+        // Take the next task from a thread's own share
+        bool take(const unsigned thread, std::size_t& index) {
+            Share& share = shares[thread];
+            std::lock_guard<std::mutex> guard(share.lock);
+            if (share.begin == share.end) {
+                return false;
+            }
+            index = share.begin++;
+            return true;
+        }
+
+        // Move the back half of another thread's share into this one's
+        bool steal(const unsigned thread) {
+            for (unsigned offset = 1; offset < shares.size(); offset++) {
+                Share& victim = shares[(thread + offset) % shares.size()];
+                std::size_t begin;
+                std::size_t end;
+                {
+                    std::lock_guard<std::mutex> guard(victim.lock);
+                    if (victim.begin == victim.end) {
+                        continue;
+                    }
+                    end = victim.end;
+                    begin = victim.begin + (victim.end - victim.begin) / 2;
+                    victim.end = begin;
+                }
+                Share& share = shares[thread];
+                std::lock_guard<std::mutex> guard(share.lock);
+                share.begin = begin;
+                share.end = end;
+                return true;
+            }
+            return false;
+        }
+
+        void work(const unsigned thread) {
+            std::size_t index;
+            do {
+                while (take(thread, index)) {
+                    task(index);
+                }
+            } while (steal(thread));
+        }
+
+    public:
+        TaskPool(const std::size_t count, const unsigned thread_count,
+                const std::function<void(std::size_t)>& task):
+            shares(thread_count),
+            task(task)
+        {
+            for (unsigned t = 0; t < thread_count; t++) {
+                shares[t].begin = count * t / thread_count;
+                shares[t].end = count * (t + 1) / thread_count;
+            }
+        }
+
+        // Run all the tasks, and return when they are done
+        void run() {
+            std::vector<std::thread> threads;
+            for (unsigned t = 1; t < shares.size(); t++) {
+                threads.push_back(std::thread(&TaskPool::work, this, t));
+            }
+            work(0);
+            for (unsigned t = 0; t < threads.size(); t++) {
+                threads[t].join();
+            }
+        }
+};
+
+// ----------------------------------------------------------------------------
+
+// The number of threads to use (0 means one per hardware thread)
+static unsigned thread_count(unsigned threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    return (threads == 0) ? 1 : threads;
+}
+
+// ============================================================================
+// Parallel parsing ___________________________________________________________
+
+// A section of a document: the lines from one Table header up to the next
+// (the first section holds the keys before any header, and may be empty).
+// The section is parsed into its own Table, and whatever stopped the parse is
+// kept to be raised at the right point when the sections are put together.
+struct Section {
+    const char* begin;
+    const char* end;
+    bool has_header;
+    std::vector<std::string> path;
+    TOML::Table table;
+    std::exception_ptr error;
+
+    Section(const char* begin): begin(begin), end(begin), has_header(false) {}
+};
+
+// ----------------------------------------------------------------------------
+
+// Builds the Table of a single Section, and notes its header
+class SectionBuilder : public TableBuilder {
+    private:
+        Section& section;
+
+    public:
+        explicit SectionBuilder(Section& section):
+            TableBuilder(section.table),
+            section(section)
+        {}
+
+        void on_table_header(const std::vector<std::string>& path) {
+            section.has_header = true;
+            section.path = path;
+        }
+};
+
+// ----------------------------------------------------------------------------
+
+// Split a document into Sections.  Every line whose first character (after
+// any blanks) is a '[' is a Table header.
+static std::vector<Section> split_sections(const char* begin,
+        const char* end) {
+    std::vector<Section> sections;
+    sections.push_back(Section(begin));
+    const char* line = begin;
+    while (line != end) {
+        const char* eol = find_newline(line, end);
+        const char* first = skip_blanks(line, eol);
+        if (first != eol && *first == '[' && line != sections.back().begin) {
+            sections.back().end = line;
+            sections.push_back(Section(line));
+        }
+        line = (eol == end) ? end : eol + 1;
+    }
+    sections.back().end = end;
+    return sections;
+}
+
+// ----------------------------------------------------------------------------
+
+// Read the header of each Section from its first line alone, without parsing
+// the rest (for a document that was parsed in one piece).  A header that
+// cannot be read leaves the Section with no path.
+static void read_headers(std::vector<Section>& sections,
+        const TOML::ParseOptions& options) {
+    for (auto it = sections.begin(); it != sections.end(); it++) {
+        const char* eol = find_newline(it->begin, it->end);
+        const char* first = skip_blanks(it->begin, eol);
+        if (first != eol && *first == '[') {
+            SectionBuilder builder(*it);
+            try {
+                TOML::parse_buffer(it->begin, eol, builder, options);
+            } catch (TOML::Error&) {
+                it->has_header = false;
+                it->path.clear();
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse the Sections on a number of threads.  A Section after one that
+// failed is never needed, so those are skipped.
+static void parse_sections(std::vector<Section>& sections,
+        const unsigned thread_count, const TOML::ParseOptions& options) {
+    std::atomic<std::size_t> first_error(sections.size());
+    TaskPool pool(sections.size(), thread_count, [&](std::size_t i) {
+        if (i > first_error) {
+            return;
+        }
+        SectionBuilder builder(sections[i]);
+        try {
+            TOML::parse_buffer(sections[i].begin, sections[i].end, builder,
+                    options);
+        } catch (...) {
+            sections[i].error = std::current_exception();
+            std::size_t known = first_error;
+            while (i < known && !first_error.compare_exchange_weak(known, i)) {
+            }
+        }
+    });
+    pool.run();
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse the Sections of a document into an (empty) Table on several threads.
+// The Sections are put together in file order exactly as a serial parse
+// would build them -- the header is checked against what is already there,
+// then the keys (which only ever go in the Table the header names) are moved
+// in -- so the same errors come out at the same point.
+static void assemble_sections(TOML::Table& root,
+        std::vector<Section>& sections, unsigned thread_count,
+        const TOML::ParseOptions& options) {
+    if (thread_count > sections.size()) {
+        thread_count = sections.size();
+    }
+    parse_sections(sections, thread_count, options);
+
+    TableBuilder builder(root);
+    for (std::size_t i = 0; i < sections.size(); i++) {
+        Section& section = sections[i];
+        if (section.has_header) {
+            builder.on_table_header(section.path);
+        } else if (i > 0) {
+            // The header itself could not be read
+            std::rethrow_exception(section.error);
+        }
+        // A Table is new (and empty) when its header is read
+        builder.current() = std::move(section.table);
+        if (section.error) {
+            std::rethrow_exception(section.error);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a document into an (empty) Table on several threads
+static void parse_parallel(TOML::Table& root, const char* begin,
+        const char* end, const unsigned thread_count,
+        const TOML::ParseOptions& options) {
+    std::vector<Section> sections = split_sections(begin, end);
+    assemble_sections(root, sections, thread_count, options);
+}
+
+// ============================================================================
+// Incremental parsing ________________________________________________________
+
+// Hash the bytes of a section (eight at a time; collisions between two
+// versions of a section are vanishingly unlikely)
+static std::uint64_t hash_bytes(const char* data, std::size_t size) {
+    std::uint64_t hash = 14695981039346656037ull ^ size;
+    while (size >= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data, 8);
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 29;
+        data += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        hash = (hash ^ static_cast<unsigned char>(*data)) * 1099511628211ull;
+        data++;
+        size--;
+    }
+    return hash;
+}
+
+// ----------------------------------------------------------------------------
+
+// The name of a section, for changed()
+static std::string section_name(const std::vector<std::string>& path) {
+    std::string name;
+    for (std::size_t i = 0; i < path.size(); i++) {
+        if (i > 0) {
+            name += ".";
+        }
+        name += path[i];
+    }
+    return name;
+}
+
+// ----------------------------------------------------------------------------
+
+TOML::IncrementalParser::IncrementalParser(Table& table,
+        const ParseOptions& options):
+    table(table),
+    options(options),
+    was_incremental(false)
+{}
+
+// ----------------------------------------------------------------------------
+
+// Parse the whole document into a new Table (so that a ParseError leaves the
+// old one alone), take it over, and record its sections.  A Table in an
+// Arena is parsed on one thread, straight into the Arena.
+void TOML::IncrementalParser::full_parse(const char* begin, const char* end) {
+    std::vector<Section> split = split_sections(begin, end);
+    Table fresh(Table(), table.arena());
+    if (table.arena() == nullptr) {
+        assemble_sections(fresh, split, thread_count(options.threads),
+                options);
+    } else {
+        TableBuilder builder(fresh);
+        TOML::parse_buffer(begin, end, builder, options);
+        read_headers(split, options);
+    }
+    table = std::move(fresh);
+
+    sections.clear();
+    changed_sections.clear();
+    for (std::size_t i = 0; i < split.size(); i++) {
+        SectionRecord record;
+        record.offset = split[i].begin - begin;
+        record.size = split[i].end - split[i].begin;
+        record.hash = hash_bytes(split[i].begin, record.size);
+        record.path = split[i].path;
+        sections.push_back(record);
+        changed_sections.push_back(section_name(record.path));
+    }
+    was_incremental = false;
+}
+
+// ----------------------------------------------------------------------------
+
+void TOML::IncrementalParser::parse_string(const std::string s) {
+    parse_buffer(s.data(), s.data() + s.size());
+}
+
+// ----------------------------------------------------------------------------
+
+void TOML::IncrementalParser::parse_file(const std::string filename) {
+    MappedFile file(filename);
+    if (file.begin() != nullptr) {
+        parse_buffer(file.begin(), file.end());
+        return;
+    }
+    // Read the file as a stream (it may be empty, or there may be no mmap)
+    std::ifstream fin(filename);
+    std::stringstream contents;
+    contents << fin.rdbuf();
+    parse_string(contents.str());
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse the sections that changed, check that the document still has the
+// same shape, and only then put the new keys in place
+void TOML::IncrementalParser::parse_buffer(const char* begin,
+        const char* end) {
+    std::vector<Section> split = split_sections(begin, end);
+    if (sections.empty() || split.size() != sections.size()) {
+        full_parse(begin, end);
+        return;
+    }
+
+    // The sections whose bytes changed
+    std::vector<Section> changed;
+    std::vector<std::size_t> index;
+    std::vector<std::uint64_t> hashes(split.size());
+    for (std::size_t i = 0; i < split.size(); i++) {
+        const std::size_t size = split[i].end - split[i].begin;
+        hashes[i] = hash_bytes(split[i].begin, size);
+        if (size != sections[i].size || hashes[i] != sections[i].hash) {
+            changed.push_back(Section(split[i].begin));
+            changed.back().end = split[i].end;
+            index.push_back(i);
+        }
+    }
+    const unsigned threads = (table.arena() == nullptr ?
+            thread_count(options.threads) : 1);
+    parse_sections(changed, std::min<std::size_t>(threads,
+                std::max<std::size_t>(changed.size(), 1)), options);
+
+    // Each changed section must still name the same Table, and parse
+    // without an error (otherwise the full parse raises the error a full
+    // parse would, which may come from elsewhere in the document).  Its keys
+    // must not clash with the sub-Tables of that Table.
+    const Table& root = table;
+    for (std::size_t c = 0; c < changed.size(); c++) {
+        if (changed[c].path != sections[index[c]].path ||
+                changed[c].error) {
+            full_parse(begin, end);
+            return;
+        }
+        const Table& target = changed[c].has_header ?
+            root.get_table(changed[c].path) : root;
+        const std::vector<std::string> keys = changed[c].table.all_keys();
+        for (auto it = keys.begin(); it != keys.end(); it++) {
+            if (target.has_table(*it)) {
+                full_parse(begin, end);
+                return;
+            }
+        }
+    }
+
+    changed_sections.clear();
+    for (std::size_t c = 0; c < changed.size(); c++) {
+        Table& target = changed[c].has_header ?
+            table.get_table(changed[c].path) : table;
+        target.replace_keys(std::move(changed[c].table));
+        changed_sections.push_back(section_name(changed[c].path));
+    }
+    for (std::size_t i = 0; i < split.size(); i++) {
+        sections[i].offset = split[i].begin - begin;
+        sections[i].size = split[i].end - split[i].begin;
+        sections[i].hash = hashes[i];
+    }
+    was_incremental = true;
+}
+
+// ----------------------------------------------------------------------------
+
+const std::vector<std::string>& TOML::IncrementalParser::changed() const {
+    return changed_sections;
+}
+
+// ----------------------------------------------------------------------------
+
+bool TOML::IncrementalParser::incremental() const {
+    return was_incremental;
+}
+
+// ============================================================================
+// Batch parsing ______________________________________________________________
+
+bool TOML::ParsedFile::ok() const {
+    return !error;
+}
+
+// ----------------------------------------------------------------------------
+
+std::string TOML::ParsedFile::message() const {
+    if (!error) {
+        return "";
+    }
+    try {
+        std::rethrow_exception(error);
+    } catch (std::exception& e) {
+        return e.what();
+    } catch (...) {
+        return "Unknown error.";
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse one file of a batch.  Unlike Table::parse_file, a file that cannot be
+// opened is an error.
+static void parse_batch_file(TOML::ParsedFile& result,
+        const TOML::ParseOptions& options) {
+    MappedFile file(result.filename);
+    if (file.begin() != nullptr) {
+        result.table.parse_buffer(file.begin(), file.end(), options);
+        return;
+    }
+    std::ifstream fin(result.filename);
+    if (!fin) {
+        throw TOML::ParseError("Unable to open file \"" + result.filename
+                + "\".");
+    }
+    result.table.parse_stream(fin, options);
+}
+
+// ----------------------------------------------------------------------------
+
+std::vector<TOML::ParsedFile> TOML::parse_files(
+        const std::vector<std::string>& filenames, const unsigned threads,
+        const ParseOptions& options) {
+    std::vector<ParsedFile> results(filenames.size());
+    // Each file is already a task of its own, so its parse is serial
+    ParseOptions file_options = options;
+    file_options.threads = 1;
+    TaskPool pool(filenames.size(), thread_count(threads),
+            [&](std::size_t i) {
+        results[i].filename = filenames[i];
+        try {
+            parse_batch_file(results[i], file_options);
+        } catch (...) {
+            results[i].table.clear();
+            results[i].error = std::current_exception();
+        }
+    });
+    pool.run();
+    return results;
+}
+
+// ============================================================================
+// Key pool ___________________________________________________________________
+
+// Hash a key (32-bit FNV-1a)
+static std::uint32_t hash_key(const char* key, const std::size_t size) {
+    std::uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(key[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// TOML_KEY works the same hash out at compile time
+static_assert(TOML::StaticKey::hash("a", 1) == 0xe40c292cu,
+        "StaticKey::hash is not 32-bit FNV-1a");
+
+// ----------------------------------------------------------------------------
+
+TOML::KeyPool::KeyPool():
+    chars(1024),
+    byte_count(0)
+{}
+
+// ----------------------------------------------------------------------------
+
+std::size_t TOML::KeyPool::size() const {
+    std::lock_guard<std::mutex> lock(guard);
+    return keys.size();
+}
+
+// ----------------------------------------------------------------------------
+
+std::size_t TOML::KeyPool::bytes() const {
+    std::lock_guard<std::mutex> lock(guard);
+    return byte_count;
+}
+
+// ----------------------------------------------------------------------------
+
+// Find a key, or copy it into the pool.  The index is open addressing with
+// linear probing, kept at most half full.  The characters of a key never
+// move once they are in the pool, but the vectors do, so they are only read
+// under the lock.
+std::uint32_t TOML::KeyPool::intern(const KeyView key,
+        const std::uint32_t hash, const char*& key_chars) {
+    std::lock_guard<std::mutex> lock(guard);
+    if (!buckets.empty()) {
+        const std::size_t mask = buckets.size() - 1;
+        for (std::size_t i = hash & mask; buckets[i] != 0;
+                i = (i + 1) & mask) {
+            const Key& k = keys[buckets[i] - 1];
+            if (k.hash == hash && k.size == key.size() &&
+                    std::memcmp(k.chars, key.data(), key.size()) == 0) {
+                key_chars = k.chars;
+                return buckets[i] - 1;
+            }
+        }
+    }
+
+    char* copy = static_cast<char*>(chars.allocate(key.size() + 1, 1));
+    std::memcpy(copy, key.data(), key.size());
+    copy[key.size()] = '\0';
+    const Key k = {copy, static_cast<std::uint32_t>(key.size()), hash};
+    keys.push_back(k);
+    byte_count += key.size();
+
+    if (2 * keys.size() > buckets.size()) {
+        const std::size_t size = buckets.empty() ? 64 : 2 * buckets.size();
+        buckets.assign(size, 0);
+        for (std::size_t id = 0; id < keys.size(); id++) {
+            std::size_t i = keys[id].hash & (size - 1);
+            while (buckets[i] != 0) {
+                i = (i + 1) & (size - 1);
+            }
+            buckets[i] = static_cast<std::uint32_t>(id + 1);
+        }
+    } else {
+        const std::size_t mask = buckets.size() - 1;
+        std::size_t i = hash & mask;
+        while (buckets[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        buckets[i] = static_cast<std::uint32_t>(keys.size());
+    }
+    key_chars = copy;
+    return static_cast<std::uint32_t>(keys.size() - 1);
+}
+
+// ============================================================================
+// Table ______________________________________________________________________
+
+// Raise the error for a missing element
+static void missing_element(const char* kind, const TOML::KeyView key) {
+    std::string message = "No ";
+    message.append(kind);
+    message.append(" at key \"");
+    message.append(key.data(), key.size());
+    message.append("\".");
+    throw TOML::TableError(message);
+}
+
+// ----------------------------------------------------------------------------
+
+// Is the whole range one key, with no blanks around it?
+static bool valid_key(const char* begin, const char* end) {
+    if (begin == end || has_class(*begin, BLANK)) {
+        return false;
+    }
+    Tokenizer tokens(begin, end);
+    try {
+        tokens.key();
+    } catch(TOML::ParseError& pe) {
+        return false;
+    }
+    return (tokens.position() == end);
+}
+
+// ----------------------------------------------------------------------------
+
+// An empty Data in the given Arena (or on the heap)
+TOML::Table::Data::Data(Arena* arena):
+    entries(ArenaAllocator<char>(arena)),
+    scalars(ArenaAllocator<char>(arena)),
+    arrays(ArenaAllocator<char>(arena)),
+    tables(ArenaAllocator<char>(arena)),
+    buckets(ArenaAllocator<char>(arena))
+{}
+
+// ----------------------------------------------------------------------------
+
+// A copy of a Data in the same Arena.  The Values and ValueArrays are copied;
+// the sub-Tables are copies of the Tables, so on the heap they are shared.
+TOML::Table::Data::Data(const Data& d):
+    pool(d.pool),
+    entries(d.entries, d.entries.get_allocator()),
+    scalars(d.scalars.get_allocator()),
+    arrays(d.arrays.get_allocator()),
+    tables(d.tables.get_allocator()),
+    buckets(d.buckets, d.buckets.get_allocator())
+{
+    Arena* arena = entries.get_allocator().arena;
+    scalars.reserve(d.scalars.size());
+    for (auto it = d.scalars.begin(); it != d.scalars.end(); it++) {
+        scalars.emplace_back(*it, arena);
+    }
+    arrays.reserve(d.arrays.size());
+    for (auto it = d.arrays.begin(); it != d.arrays.end(); it++) {
+        arrays.emplace_back(*it, arena);
+    }
+    tables.reserve(d.tables.size());
+    for (auto it = d.tables.begin(); it != d.tables.end(); it++) {
+        if (arena == nullptr) {
+            tables.push_back(*it);
+        } else {
+            tables.push_back(Table(*it, arena, pool));
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// A new empty Data for a sub-Table (which lives in the Arena, if there is one;
+// the Data of a Table that is not inside another is always on the heap, so
+// that the Table can be cleared and outlive its Arena)
+std::shared_ptr<TOML::Table::Data> TOML::Table::new_data(Arena* arena) {
+    return std::allocate_shared<Data>(ArenaAllocator<Data>(arena), arena);
+}
+
+// ----------------------------------------------------------------------------
+
+// The empty Data that empty heap Tables share (it is never changed: a Table
+// takes its own copy before it adds anything)
+std::shared_ptr<TOML::Table::Data> TOML::Table::empty_data() {
+    static const std::shared_ptr<Data> empty = new_data(nullptr);
+    return empty;
+}
+
+// ----------------------------------------------------------------------------
+
+// The Data, after taking a copy of it if it is shared
+TOML::Table::Data& TOML::Table::mutate() {
+    if (data.use_count() > 1) {
+        data = std::allocate_shared<Data>(ArenaAllocator<Data>(arena()),
+                *data);
+    }
+    return *data;
+}
+
+// ----------------------------------------------------------------------------
+
+// Is this Table, or one of its sub-Tables, the given one?
+bool TOML::Table::contains(const Table* t) const {
+    if (this == t) {
+        return true;
+    }
+    for (auto it = data->tables.begin(); it != data->tables.end(); it++) {
+        if (it->contains(t)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct an empty Table on the heap
+TOML::Table::Table():
+    data(empty_data())
+{}
+
+// ----------------------------------------------------------------------------
+
+// Construct an empty Table in an Arena.  Everything parsed or added into the
+// Table (including sub-Tables) is then allocated from the Arena, except for
+// the keys, which are kept once each in the Table's KeyPool.
+TOML::Table::Table(Arena& arena):
+    data(std::make_shared<Data>(&arena))
+{}
+
+// ----------------------------------------------------------------------------
+
+// Construct a deep copy of a Table that lives in the given Arena.  The copy
+// shares the KeyPool of the original.
+TOML::Table::Table(const Table& t, Arena* arena):
+    data(std::make_shared<Data>(arena))
+{
+    copy_contents(*t.data, t.data->pool);
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a deep copy of a sub-Table that lives in the given Arena and keeps
+// its keys in the given KeyPool
+TOML::Table::Table(const Table& t, Arena* arena,
+        const std::shared_ptr<KeyPool>& pool):
+    data(new_data(arena))
+{
+    copy_contents(*t.data, pool);
+}
+
+// ----------------------------------------------------------------------------
+
+// Fill an empty Table with a deep copy of the contents of another, in this
+// Table's Arena and the given KeyPool
+void TOML::Table::copy_contents(const Data& from,
+        const std::shared_ptr<KeyPool>& pool) {
+    Arena* arena = this->arena();
+    Data& d = *data;
+    d.pool = pool;
+    d.entries.assign(from.entries.begin(), from.entries.end());
+    d.buckets.assign(from.buckets.begin(), from.buckets.end());
+    // The slots and the index carry over unchanged.  If the pool is another
+    // one, the keys are moved into it (which only changes their ids and
+    // where they point).
+    if (pool != from.pool) {
+        for (auto it = d.entries.begin(); it != d.entries.end(); it++) {
+            it->id = pool->intern(KeyView(it->key, it->size), it->hash,
+                    it->key);
+        }
+    }
+    d.scalars.reserve(from.scalars.size());
+    for (auto it = from.scalars.begin(); it != from.scalars.end(); it++) {
+        d.scalars.emplace_back(*it, arena);
+    }
+    d.arrays.reserve(from.arrays.size());
+    for (auto it = from.arrays.begin(); it != from.arrays.end(); it++) {
+        d.arrays.emplace_back(*it, arena);
+    }
+    d.tables.reserve(from.tables.size());
+    for (auto it = from.tables.begin(); it != from.tables.end(); it++) {
+        d.tables.push_back(Table(*it, arena, pool));
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct an empty Table in the given Arena (or on the heap) that keeps its
+// keys in the given KeyPool
+TOML::Table::Table(Arena* arena, const std::shared_ptr<KeyPool>& pool):
+    data(new_data(arena))
+{
+    data->pool = pool;
+}
+
+// ----------------------------------------------------------------------------
+
+// Construct a copy of a Table, which shares its contents (unless they are in
+// an Arena)
+TOML::Table::Table(const Table& t):
+    data((t.arena() == nullptr) ? t.data : Table(t, nullptr).data)
+{}
+
+// ----------------------------------------------------------------------------
+
+// Take over the contents of a Table, leaving it empty
+TOML::Table::Table(Table&& t) noexcept:
+    data(std::move(t.data))
+{
+    t.data = empty_data();
+}
+
+// ----------------------------------------------------------------------------
+
+// Assign a copy of a Table, which shares its contents (unless they are in an
+// Arena)
+TOML::Table& TOML::Table::operator= (const Table& t) {
+    if (this != &t) {
+        data = (t.arena() == nullptr) ? t.data : Table(t, nullptr).data;
+    }
+    return *this;
+}
+
+// ----------------------------------------------------------------------------
+
+// Take over the contents of a Table, leaving it empty.  (The contents are
+// taken before they are released, as the Table may be inside this one.)
+TOML::Table& TOML::Table::operator= (Table&& t) noexcept {
+    if (this != &t) {
+        std::shared_ptr<Data> taken = std::move(t.data);
+        t.data = empty_data();
+        data = std::move(taken);
+    }
+    return *this;
+}
+
+// ----------------------------------------------------------------------------
+
+// The Arena holding this Table (nullptr for the heap)
+TOML::Arena* TOML::Table::arena() const {
+    return data->entries.get_allocator().arena;
+}
+
+// ----------------------------------------------------------------------------
+
+// Find the Entry for a key of the given kind (or of any kind)
+long TOML::Table::find(const KeyView key, const std::uint32_t hash,
+        const Kind kind) const {
+    const Data& d = *data;
+    if (d.buckets.empty()) {
+        return -1;
+    }
+    const std::size_t mask = d.buckets.size() - 1;
+    for (std::size_t i = hash & mask; d.buckets[i].entry != 0;
+            i = (i + 1) & mask) {
+        if (d.buckets[i].hash != hash) {
+            continue;
+        }
+        const Entry& entry = d.entries[d.buckets[i].entry - 1];
+        if ((kind == ANY || entry.kind == kind) &&
+                entry.size == key.size() &&
+                std::memcmp(entry.key, key.data(), key.size()) == 0) {
+            return d.buckets[i].entry - 1;
+        }
+    }
+    return -1;
+}
+
+long TOML::Table::find(const KeyView key, const Kind kind) const {
+    return find(key, hash_key(key.data(), key.size()), kind);
+}
+
+// ----------------------------------------------------------------------------
+
+// Find the Entry for a Symbol: by id if it is from this Table's pool, and
+// otherwise by name
+long TOML::Table::find(const Symbol& key, const Kind kind) const {
+    const Data& d = *data;
+    if (key.pool != d.pool || d.pool == nullptr) {
+        return find(key.name(), key.hash, kind);
+    }
+    if (d.buckets.empty()) {
+        return -1;
+    }
+    const std::size_t mask = d.buckets.size() - 1;
+    for (std::size_t i = key.hash & mask; d.buckets[i].entry != 0;
+            i = (i + 1) & mask) {
+        const Entry& entry = d.entries[d.buckets[i].entry - 1];
+        if (entry.id == key.id && (kind == ANY || entry.kind == kind)) {
+            return d.buckets[i].entry - 1;
+        }
+    }
+    return -1;
+}
+
+long TOML::Table::find(const StaticKey& key, const Kind kind) const {
+    return find(key.name(), key.key_hash, kind);
+}
+
+// ----------------------------------------------------------------------------
+
+// Add an Entry for an element that has just been stored, growing the index
+// when it would be more than half full
+void TOML::Table::insert(const KeyView key, const std::uint32_t hash,
+        const Kind kind, const std::size_t slot) {
+    Data& d = mutate();
+    if (d.pool == nullptr) {
+        d.pool = std::make_shared<KeyPool>();
+    }
+    const char* chars;
+    const std::uint32_t id = d.pool->intern(key, hash, chars);
+    const Entry entry = {chars, static_cast<std::uint32_t>(key.size()), hash,
+        id, kind, static_cast<std::uint32_t>(slot)};
+    d.entries.push_back(entry);
+
+    if (2 * d.entries.size() > d.buckets.size()) {
+        // Rebuild the index from the stored hashes
+        const std::size_t size = d.buckets.empty() ? 16 : 2 * d.buckets.size();
+        const Bucket empty = {0, 0};
+        d.buckets.assign(size, empty);
+        for (std::size_t e = 0; e < d.entries.size(); e++) {
+            std::size_t i = d.entries[e].hash & (size - 1);
+            while (d.buckets[i].entry != 0) {
+                i = (i + 1) & (size - 1);
+            }
+            d.buckets[i].hash = d.entries[e].hash;
+            d.buckets[i].entry = static_cast<std::uint32_t>(e + 1);
+        }
+    } else {
+        const std::size_t mask = d.buckets.size() - 1;
+        std::size_t i = hash & mask;
+        while (d.buckets[i].entry != 0) {
+            i = (i + 1) & mask;
+        }
+        d.buckets[i].hash = hash;
+        d.buckets[i].entry = static_cast<std::uint32_t>(d.entries.size());
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Keys may be given once for each kind of element, and must be valid
+void TOML::Table::check_new_key(const KeyView key, const std::uint32_t hash,
+        const Kind kind) const {
+    if (find(key, hash, kind) != -1) {
+        throw TOML::TableError("Key \"" + key.str() + "\" already exists.");
+    }
+    if (!::valid_key(key.data(), key.data() + key.size())) {
+        throw TOML::TableError("Key \"" + key.str() + "\" is invalid.");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// The Entries of one kind, sorted by key (the order of the output)
+std::vector<std::uint32_t> TOML::Table::sorted(const Kind kind) const {
+    const Data& d = *data;
+    std::vector<std::uint32_t> order;
+    for (std::size_t e = 0; e < d.entries.size(); e++) {
+        if (d.entries[e].kind == kind) {
+            order.push_back(static_cast<std::uint32_t>(e));
+        }
+    }
+    std::sort(order.begin(), order.end(),
+            [&](const std::uint32_t a, const std::uint32_t b) {
+        const Entry& x = d.entries[a];
+        const Entry& y = d.entries[b];
+        const int c = std::memcmp(x.key, y.key, std::min(x.size, y.size));
+        return (c != 0) ? (c < 0) : (x.size < y.size);
+    });
+    return order;
+}
+
+// ----------------------------------------------------------------------------
+
+// Move the keys of this Table and its sub-Tables into another pool (which only
+// changes their ids and where they point)
+void TOML::Table::move_keys(const std::shared_ptr<KeyPool>& to) {
+    Data& d = mutate();
+    for (auto it = d.entries.begin(); it != d.entries.end(); it++) {
+        it->id = to->intern(KeyView(it->key, it->size), it->hash, it->key);
+    }
+    d.pool = to;
+    for (auto it = d.tables.begin(); it != d.tables.end(); it++) {
+        it->move_keys(to);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Replace the scalars and arrays of the Table (the index is rebuilt over the
+// sub-Tables, which stay where they are, and the new elements are added)
+void TOML::Table::replace_keys(Table&& from) {
+    Data& d = mutate();
+    std::vector<Entry> kept;
+    for (auto it = d.entries.begin(); it != d.entries.end(); it++) {
+        if (it->kind == TABLE) {
+            kept.push_back(*it);
+        }
+    }
+    d.entries.clear();
+    d.scalars.clear();
+    d.arrays.clear();
+    d.buckets.clear();
+    for (auto it = kept.begin(); it != kept.end(); it++) {
+        insert(KeyView(it->key, it->size), it->hash, TABLE, it->slot);
+    }
+
+    Data& f = from.mutate();
+    for (auto it = f.entries.begin(); it != f.entries.end(); it++) {
+        const KeyView key(it->key, it->size);
+        if (it->kind == SCALAR) {
+            add(key, std::move(f.scalars[it->slot]));
+        } else if (it->kind == ARRAY) {
+            add(key, std::move(f.arrays[it->slot]));
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Intern a key in the Table's pool
+TOML::Symbol TOML::Table::symbol(const KeyView key) {
+    if (data->pool == nullptr) {
+        mutate().pool = std::make_shared<KeyPool>();
+    }
+    const std::shared_ptr<KeyPool>& pool = data->pool;
+    Symbol symbol;
+    symbol.hash = hash_key(key.data(), key.size());
+    symbol.id = pool->intern(key, symbol.hash, symbol.chars);
+    symbol.length = static_cast<std::uint32_t>(key.size());
+    symbol.pool = pool;
+    return symbol;
+}
+
+// ----------------------------------------------------------------------------
+
+std::shared_ptr<const TOML::KeyPool> TOML::Table::key_pool() const {
+    const Data& d = *data;
+    return d.pool;
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a Table from a string.  A failure results in a ParseError, and clears
+// the Table.
+void TOML::Table::parse_string(const std::string s,
+        const ParseOptions& options) {
+    parse_buffer(s.data(), s.data() + s.size(), options);
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a Table from a file (specified by the file name).  A failure results
+// in a ParseError, and clears the Table.
+void TOML::Table::parse_file(const std::string filename,
+        const ParseOptions& options) {
+    MappedFile file(filename);
+    if (file.begin() != nullptr) {
+        parse_buffer(file.begin(), file.end(), options);
+        return;
+    }
+    // Open the file as a filestream and parse that stream
+    std::ifstream fin;
+    fin.open(filename);
+    parse_stream(fin, options);
+    fin.close();    // Don't forget to close the file!
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a Table from a stream.  A failure results in a ParseError, and clears
+// the Table.
+void TOML::Table::parse_stream(std::istream& sin,
+        const ParseOptions& options) {
+    clear();
+    TableBuilder builder(*this);
+    try {
+        TOML::parse_stream(sin, builder, options);
+    } catch (TOML::ParseError& pe) {
+        clear();
+        throw;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// Parse a Table from a buffer of characters [begin, end).  A failure results
+// in a ParseError, and clears the Table.
+void TOML::Table::parse_buffer(const char* begin, const char* end,
+        const ParseOptions& options) {
+    clear();
+    const unsigned threads = thread_count(options.threads);
+    try {
+        if (threads > 1 && arena() == nullptr) {
+            parse_parallel(*this, begin, end, threads, options);
+        } else {
+            TableBuilder builder(*this);
+            TOML::parse_buffer(begin, end, builder, options);
+        }
+    } catch (TOML::ParseError& pe) {
+        clear();
+        throw;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+bool TOML::Table::valid_key(const std::string& key) {
+    return ::valid_key(key.data(), key.data() + key.size());
+}
+
+// ----------------------------------------------------------------------------
+
+// Add a Value to the Table
+void TOML::Table::add(const KeyView key, const Value& v) {
+    const std::uint32_t hash = hash_key(key.data(), key.size());
+    check_new_key(key, hash, SCALAR);
+    Data& d = mutate();
+    d.scalars.emplace_back(v, arena());
+    insert(key, hash, SCALAR, d.scalars.size() - 1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Add a ValueArray to the Table
+void TOML::Table::add(const KeyView key, const ValueArray& va) {
+    const std::uint32_t hash = hash_key(key.data(), key.size());
+    check_new_key(key, hash, ARRAY);
+    Data& d = mutate();
+    d.arrays.emplace_back(va, arena());
+    insert(key, hash, ARRAY, d.arrays.size() - 1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Add a sub-Table to the Table.  A heap Table that keeps its keys in this
+// Table's pool (or that can bring its pool along) is shared; any other is
+// copied into this Table's Arena and pool, as is a Table that holds this one.
+void TOML::Table::add(const KeyView key, const Table& t) {
+    if (this == &t) {
+        throw TOML::TableError("Cannot have recursive tables.");
+    }
+    const std::uint32_t hash = hash_key(key.data(), key.size());
+    check_new_key(key, hash, TABLE);
+    Data& d = mutate();
+    if (d.pool == nullptr) {
+        d.pool = (t.data->pool != nullptr) ? t.data->pool :
+            std::make_shared<KeyPool>();
+    }
+    if (arena() == nullptr && t.arena() == nullptr &&
+            t.data->pool == d.pool && !t.contains(this)) {
+        d.tables.push_back(t);
+    } else {
+        // The copy (and its sub-Tables) keep their keys in this Table's pool
+        d.tables.push_back(Table(t, arena(), d.pool));
+    }
+    insert(key, hash, TABLE, d.tables.size() - 1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Add a Value to the Table, taking it over
+void TOML::Table::add(const KeyView key, Value&& v) {
+    const std::uint32_t hash = hash_key(key.data(), key.size());
+    check_new_key(key, hash, SCALAR);
+    Data& d = mutate();
+    d.scalars.emplace_back(std::move(v), arena());
+    insert(key, hash, SCALAR, d.scalars.size() - 1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Add a ValueArray to the Table, taking it over
+void TOML::Table::add(const KeyView key, ValueArray&& va) {
+    const std::uint32_t hash = hash_key(key.data(), key.size());
+    check_new_key(key, hash, ARRAY);
+    Data& d = mutate();
+    d.arrays.emplace_back(std::move(va), arena());
+    insert(key, hash, ARRAY, d.arrays.size() - 1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Add a sub-Table to the Table, taking it over.  Only a Table in the same
+// Arena (or on the heap, like this one) that does not hold this one can be
+// taken over; any other is copied.
+void TOML::Table::add(const KeyView key, Table&& t) {
+    if (t.arena() != arena() || t.contains(this)) {
+        add(key, static_cast<const Table&>(t));
+        return;
+    }
+    const std::uint32_t hash = hash_key(key.data(), key.size());
+    check_new_key(key, hash, TABLE);
+    Data& d = mutate();
+    // The Table keeps its keys where they are if this Table has no pool yet
+    if (d.pool == nullptr) {
+        d.pool = (t.data->pool != nullptr) ? t.data->pool :
+            std::make_shared<KeyPool>();
+    }
+    if (t.data->pool != d.pool) {
+        t.move_keys(d.pool);
+    }
+    d.tables.push_back(std::move(t));
+    insert(key, hash, TABLE, d.tables.size() - 1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Add an empty ValueArray to the Table and return it
+TOML::ValueArray& TOML::Table::add_array(const KeyView key) {
+    const std::uint32_t hash = hash_key(key.data(), key.size());
+    check_new_key(key, hash, ARRAY);
+    Data& d = mutate();
+    d.arrays.emplace_back(arena());
+    insert(key, hash, ARRAY, d.arrays.size() - 1);
+    return d.arrays.back();
+}
+
+// ----------------------------------------------------------------------------
+
+// Add an empty sub-Table to the Table and return it
+TOML::Table& TOML::Table::add_table(const KeyView key) {
+    const std::uint32_t hash = hash_key(key.data(), key.size());
+    check_new_key(key, hash, TABLE);
+    Data& d = mutate();
+    if (d.pool == nullptr) {
+        d.pool = std::make_shared<KeyPool>();
+    }
+    d.tables.push_back(Table(arena(), d.pool));
+    insert(key, hash, TABLE, d.tables.size() - 1);
+    return d.tables.back();
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the set of all keys in the Table
+std::vector<std::string> TOML::Table::all_keys() const {
+    std::vector<std::string> v = scalar_keys();
+    std::vector<std::string> arrays = array_keys();
+    v.insert(v.end(), arrays.begin(), arrays.end());
+    return v;
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the set of keys to scalars in the Table
+std::vector<std::string> TOML::Table::scalar_keys() const {
+    const Data& d = *data;
+    std::vector<std::string> v;
+    std::vector<std::uint32_t> order = sorted(SCALAR);
+    for (auto it = order.begin(); it != order.end(); it++) {
+        v.push_back(std::string(d.entries[*it].key, d.entries[*it].size));
+    }
+    return v;
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the set of keys to arrays in the Table
+std::vector<std::string> TOML::Table::array_keys() const {
+    const Data& d = *data;
+    std::vector<std::string> v;
+    std::vector<std::uint32_t> order = sorted(ARRAY);
+    for (auto it = order.begin(); it != order.end(); it++) {
+        v.push_back(std::string(d.entries[*it].key, d.entries[*it].size));
+    }
+    return v;
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the set of keys to tables in the Table
+std::vector<std::string> TOML::Table::table_keys() const {
+    const Data& d = *data;
+    std::vector<std::string> v;
+    std::vector<std::uint32_t> order = sorted(TABLE);
+    for (auto it = order.begin(); it != order.end(); it++) {
+        v.push_back(std::string(d.entries[*it].key, d.entries[*it].size));
+    }
+    return v;
+}
+
+// ----------------------------------------------------------------------------
+
+// Does the Table have an element with this key?
+bool TOML::Table::has(const KeyView key) const {
+    return (find(key, ANY) != -1);
+}
+
+bool TOML::Table::has(const Symbol& key) const {
+    return (find(key, ANY) != -1);
+}
+
+bool TOML::Table::has(const StaticKey& key) const {
+    return (find(key, ANY) != -1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Does the Table have a scalar Value with this key?
+bool TOML::Table::has_scalar(const KeyView key) const {
+    return (find(key, SCALAR) != -1);
+}
+
+bool TOML::Table::has_scalar(const Symbol& key) const {
+    return (find(key, SCALAR) != -1);
+}
+
+bool TOML::Table::has_scalar(const StaticKey& key) const {
+    return (find(key, SCALAR) != -1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Does the Table have a ValueArray with this key?
+bool TOML::Table::has_array(const KeyView key) const {
+    return (find(key, ARRAY) != -1);
+}
+
+bool TOML::Table::has_array(const Symbol& key) const {
+    return (find(key, ARRAY) != -1);
+}
+
+bool TOML::Table::has_array(const StaticKey& key) const {
+    return (find(key, ARRAY) != -1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Does the Table have a Table with this key?
+bool TOML::Table::has_table(const KeyView key) const {
+    return (find(key, TABLE) != -1);
+}
+
+bool TOML::Table::has_table(const Symbol& key) const {
+    return (find(key, TABLE) != -1);
+}
+
+bool TOML::Table::has_table(const StaticKey& key) const {
+    return (find(key, TABLE) != -1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Does the Table have an element with this path?
+bool TOML::Table::has(const std::vector<std::string>& path) const {
+    const Table* current_table = this;
+    for (unsigned index = 0; index < path.size(); index++) {
+        if (current_table->has(path[index])) {
+            if (index != path.size() - 1) {
+                current_table = &(current_table->get_table(path[index]));
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+// Access a Value according to its key within the Table
+TOML::Value& TOML::Table::get_scalar(const KeyView key) {
+    Data& d = mutate();
+    const long e = find(key, SCALAR);
+    if (e == -1) {
+        missing_element("scalar", key);
+    }
+    return d.scalars[d.entries[e].slot];
+}
+
+TOML::Value& TOML::Table::get_scalar(const Symbol& key) {
+    Data& d = mutate();
+    const long e = find(key, SCALAR);
+    if (e == -1) {
+        missing_element("scalar", key.name());
+    }
+    return d.scalars[d.entries[e].slot];
+}
+
+TOML::Value& TOML::Table::get_scalar(const StaticKey& key) {
+    Data& d = mutate();
+    const long e = find(key, SCALAR);
+    if (e == -1) {
+        missing_element("scalar", key.name());
+    }
+    return d.scalars[d.entries[e].slot];
+}
+
+// ----------------------------------------------------------------------------
+
+// Access a Value according to its key within the Table (const version)
+const TOML::Value& TOML::Table::get_scalar(const KeyView key) const {
+    const Data& d = *data;
+    const long e = find(key, SCALAR);
+    if (e == -1) {
+        missing_element("scalar", key);
+    }
+    return d.scalars[d.entries[e].slot];
+}
+
+const TOML::Value& TOML::Table::get_scalar(const Symbol& key) const {
+    const Data& d = *data;
+    const long e = find(key, SCALAR);
+    if (e == -1) {
+        missing_element("scalar", key.name());
+    }
+    return d.scalars[d.entries[e].slot];
+}
+
+const TOML::Value& TOML::Table::get_scalar(const StaticKey& key) const {
+    const Data& d = *data;
+    const long e = find(key, SCALAR);
+    if (e == -1) {
+        missing_element("scalar", key.name());
+    }
+    return d.scalars[d.entries[e].slot];
+}
+
+// ----------------------------------------------------------------------------
+
+// Access a ValueArray according to its key within the Table
+TOML::ValueArray& TOML::Table::get_array(const KeyView key) {
+    Data& d = mutate();
+    const long e = find(key, ARRAY);
+    if (e == -1) {
+        missing_element("array", key);
+    }
+    return d.arrays[d.entries[e].slot];
+}
+
+TOML::ValueArray& TOML::Table::get_array(const Symbol& key) {
+    Data& d = mutate();
+    const long e = find(key, ARRAY);
+    if (e == -1) {
+        missing_element("array", key.name());
+    }
+    return d.arrays[d.entries[e].slot];
+}
+
+TOML::ValueArray& TOML::Table::get_array(const StaticKey& key) {
+    Data& d = mutate();
+    const long e = find(key, ARRAY);
+    if (e == -1) {
+        missing_element("array", key.name());
+    }
+    return d.arrays[d.entries[e].slot];
+}
+
+// ----------------------------------------------------------------------------
+
+// Access a ValueArray according to its key within the Table (const version)
+const TOML::ValueArray& TOML::Table::get_array(const KeyView key) const {
+    const Data& d = *data;
+    const long e = find(key, ARRAY);
+    if (e == -1) {
+        missing_element("array", key);
+    }
+    return d.arrays[d.entries[e].slot];
+}
+
+const TOML::ValueArray& TOML::Table::get_array(const Symbol& key) const {
+    const Data& d = *data;
+    const long e = find(key, ARRAY);
+    if (e == -1) {
+        missing_element("array", key.name());
+    }
+    return d.arrays[d.entries[e].slot];
+}
+
+const TOML::ValueArray& TOML::Table::get_array(const StaticKey& key) const {
+    const Data& d = *data;
+    const long e = find(key, ARRAY);
+    if (e == -1) {
+        missing_element("array", key.name());
+    }
+    return d.arrays[d.entries[e].slot];
+}
+
+// ----------------------------------------------------------------------------
+
+// Access a Table according to its key within the Table
+TOML::Table& TOML::Table::get_table(const KeyView key) {
+    Data& d = mutate();
+    const long e = find(key, TABLE);
+    if (e == -1) {
+        missing_element("table", key);
+    }
+    return d.tables[d.entries[e].slot];
+}
+
+TOML::Table& TOML::Table::get_table(const Symbol& key) {
+    Data& d = mutate();
+    const long e = find(key, TABLE);
+    if (e == -1) {
+        missing_element("table", key.name());
+    }
+    return d.tables[d.entries[e].slot];
+}
+
+TOML::Table& TOML::Table::get_table(const StaticKey& key) {
+    Data& d = mutate();
+    const long e = find(key, TABLE);
+    if (e == -1) {
+        missing_element("table", key.name());
+    }
+    return d.tables[d.entries[e].slot];
+}
+
+// ----------------------------------------------------------------------------
+
+// Access a Table according to its key within the Table (const version)
+const TOML::Table& TOML::Table::get_table(const KeyView key) const {
+    const Data& d = *data;
+    const long e = find(key, TABLE);
+    if (e == -1) {
+        missing_element("table", key);
+    }
+    return d.tables[d.entries[e].slot];
+}
+
+const TOML::Table& TOML::Table::get_table(const Symbol& key) const {
+    const Data& d = *data;
+    const long e = find(key, TABLE);
+    if (e == -1) {
+        missing_element("table", key.name());
+    }
+    return d.tables[d.entries[e].slot];
+}
+
+const TOML::Table& TOML::Table::get_table(const StaticKey& key) const {
+    const Data& d = *data;
+    const long e = find(key, TABLE);
+    if (e == -1) {
+        missing_element("table", key.name());
+    }
+    return d.tables[d.entries[e].slot];
+}
+
+// ----------------------------------------------------------------------------
+
+// Find a subtable from a path.  The create flag specifies whether or not to
+// create table if missing (including intermediate tables).
+TOML::Table& TOML::Table::get_table(
+        const std::vector<std::string>& path, const bool create) {
+    Table* current_table = this;
+    for (auto it = path.begin(); it != path.end(); it++) {
+        if (create && !current_table->has(*it)) {
+            // if create is false, we won't add the new table and get_table()
+            // below will generate the appropriate error for a missing key
+            current_table = &current_table->add_table(*it);
+        } else {
+            current_table = &current_table->get_table(*it);
+        }
+    }
+    return *current_table;
+}
+
+// ----------------------------------------------------------------------------
+
+// Find a subtable from a path.  This is the const version.
+const TOML::Table& TOML::Table::get_table(
+        const std::vector<std::string>& path) const {
+    const Table* current_table = this;
+    for (auto it = path.begin(); it != path.end(); it++) {
+        current_table = &(current_table->get_table(*it));
+    }
+    return *current_table;
+}
+
+// ----------------------------------------------------------------------------
+
+// Split a dotted path ("experiment.step_small") into its keys, or raise a
+// ParseError
+static std::vector<std::string> split_path(const TOML::KeyView path) {
+    std::vector<std::string> keys;
+    Tokenizer tokens(path.data(), path.data() + path.size());
+    keys.push_back(tokens.key());
+    TOML::Token token = tokens.next(Tokenizer::KEY);
+    while (token.type == TOML::Token::DOT) {
+        keys.push_back(tokens.key());
+        token = tokens.next(Tokenizer::KEY);
+    }
+    if (token.type != TOML::Token::END_OF_LINE) {
+        throw TOML::ParseError("Malformed path \"" + path.str() + "\".");
+    }
+    return keys;
+}
+
+// ----------------------------------------------------------------------------
+
+// Find an element from a dotted path
+TOML::Path TOML::Table::resolve(const KeyView path) {
+    std::vector<std::string> keys = split_path(path);
+
+    // Every key but the last is a Table
+    Table* current_table = this;
+    for (unsigned index = 0; index < keys.size() - 1; index++) {
+        current_table = &current_table->get_table(keys[index]);
+    }
+    Table& t = *current_table;
+    Data& d = t.mutate();
+    const std::string& last = keys.back();
+    Path handle;
+    long e;
+    if ((e = t.find(last, SCALAR)) != -1) {
+        handle.scalar = &d.scalars[d.entries[e].slot];
+    } else if ((e = t.find(last, ARRAY)) != -1) {
+        handle.array = &d.arrays[d.entries[e].slot];
+    } else if ((e = t.find(last, TABLE)) != -1) {
+        handle.table = &d.tables[d.entries[e].slot];
+    } else {
+        missing_element("element", last);
+    }
+    return handle;
+}
+
+// ----------------------------------------------------------------------------
+
+// Clear the Table
+void TOML::Table::clear() {
+    if (data.use_count() > 1) {
+        // The contents are still used by a copy, so start afresh
+        data = (arena() == nullptr) ? empty_data() : new_data(arena());
+        return;
+    }
+    Data& d = *data;
+    d.pool.reset();
+    d.entries.clear();
+    d.scalars.clear();
+    d.arrays.clear();
+    d.tables.clear();
+    d.buckets.clear();
+}
+
+// ----------------------------------------------------------------------------
+
+// Convert the Table to a std::string as if writing a new TOML file
+std::string TOML::Table::serialize(unsigned indent_level) const {
+    const Data& d = *data;
+    std::string indent("");
+    for (unsigned i = 0; i < indent_level; i++) {
+        indent += "    ";
+    }
+    std::stringstream ss("");
+    std::vector<std::uint32_t> order = sorted(SCALAR);
+    for (auto it = order.begin(); it != order.end(); it++) {
+        ss << indent;
+        ss.write(d.entries[*it].key, d.entries[*it].size);
+        ss << " = "
+            << d.scalars[d.entries[*it].slot] << std::endl;
+    }
+    order = sorted(ARRAY);
+    for (auto it = order.begin(); it != order.end(); it++) {
+        ss << indent;
+        ss.write(d.entries[*it].key, d.entries[*it].size);
+        ss << " = "
+            << d.arrays[d.entries[*it].slot] << std::endl;
+    }
+    order = sorted(TABLE);
+    for (auto it = order.begin(); it != order.end(); it++) {
+        ss << indent << "[";
+        ss.write(d.entries[*it].key, d.entries[*it].size);
+        ss << "]" << std::endl;
+        ss << d.tables[d.entries[*it].slot].serialize(indent_level+1)
+            << std::endl;
+    }
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------------
+
+// Write a Table to a stream
+std::ostream& TOML::operator<< (std::ostream& sout, const TOML::Table& t) {
+    sout << t.serialize();
+    return sout;
+}
+
+// ============================================================================
+// Path _______________________________________________________________________
+
+// Access the element of a Path
+TOML::Value& TOML::Path::get_scalar() const {
+    if (scalar == nullptr) {
+        throw TOML::TableError("The path is not to a scalar.");
+    }
+    return *scalar;
+}
+
+// ----------------------------------------------------------------------------
+
+TOML::ValueArray& TOML::Path::get_array() const {
+    if (array == nullptr) {
+        throw TOML::TableError("The path is not to an array.");
+    }
+    return *array;
+}
+
+// ----------------------------------------------------------------------------
+
+TOML::Table& TOML::Path::get_table() const {
+    if (table == nullptr) {
+        throw TOML::TableError("The path is not to a table.");
+    }
+    return *table;
+}
+
+// ============================================================================
+// Frozen table _______________________________________________________________
+
+// The start of every frozen buffer
+static const char frozen_magic[8] = {'T', 'O', 'M', 'L', 'F', 'R', 'Z', '1'};
+
+// The buffer of an empty FrozenTable (an empty root Table)
+struct EmptyFrozen {
+    TOML::FrozenLayout::Header header;
+    TOML::FrozenLayout::Record record;
+};
+
+static const EmptyFrozen empty_frozen = {
+    {{'T', 'O', 'M', 'L', 'F', 'R', 'Z', '1'},
+        sizeof(EmptyFrozen), offsetof(EmptyFrozen, record)},
+    {0, 0}
+};
+
+// ----------------------------------------------------------------------------
+
+// Packs a Table and everything in it into one buffer, each part after the
+// parts it refers to
+class TOML::FrozenWriter {
+    private:
+        std::vector<char> buffer;
+        // Where the characters of each key (by its place in the KeyPool) are
+        std::unordered_map<const char*, std::uint32_t> keys;
+
+        // Make room at the end of the buffer and return the offset of it
+        // -- The buffer may move, so objects are only written in place once
+        //    everything they refer to has been written.
+        std::uint32_t reserve(const std::size_t bytes,
+                const std::size_t alignment) {
+            const std::size_t offset =
+                (buffer.size() + alignment - 1) & ~(alignment - 1);
+            if (offset + bytes > UINT32_MAX) {
+                throw TOML::Error("The Table is too large to freeze.");
+            }
+            buffer.resize(offset + bytes);
+            return static_cast<std::uint32_t>(offset);
+        }
+
+        template <class T>
+        T* at(const std::uint32_t offset) {
+            return reinterpret_cast<T*>(buffer.data() + offset);
+        }
+
+        // Copy characters into the buffer
+        std::uint32_t text(const char* chars, const std::size_t size) {
+            const std::uint32_t offset = reserve(size, 1);
+            std::memcpy(buffer.data() + offset, chars, size);
+            return offset;
+        }
+
+        // The characters of a key, copied the first time they are seen
+        std::uint32_t key(const char* chars, const std::size_t size) {
+            auto it = keys.find(chars);
+            if (it != keys.end()) {
+                return it->second;
+            }
+            const std::uint32_t offset = text(chars, size);
+            keys.emplace(chars, offset);
+            return offset;
+        }
+
+        // A Value, decoded (its characters are written now)
+        FrozenLayout::Scalar scalar(const Value& v) {
+            FrozenLayout::Scalar s;
+            std::memset(&s, 0, sizeof(s));  // So that padding is always zero
+            if (v.is_valid_boolean()) {
+                s.type = FrozenLayout::BOOLEAN;
+                s.value.boolean = v.as_boolean();
+            } else if (v.is_valid_string()) {
+                const TOML::String chars = v.as_string();
+                s.type = FrozenLayout::STRING;
+                s.size = static_cast<std::uint32_t>(chars.size());
+                s.value.text = text(chars.data(), chars.size());
+            } else if (v.is_valid_float()) {
+                // A whole Float stays a Float (it is still read as an
+                // Integer too), so that -0.0 keeps its sign
+                v.decode();
+                if (v.kind == Value::INTEGER) {
+                    s.type = FrozenLayout::INTEGER;
+                    s.value.integer = v.payload.integer;
+                } else {
+                    s.type = FrozenLayout::FLOAT;
+                    s.value.floating = v.payload.floating;
+                }
+            } else {
+                s.type = FrozenLayout::EMPTY;
+            }
+            return s;
+        }
+
+        // A ValueArray: its Array and Scalars
+        std::uint32_t array(const ValueArray& va) {
+            std::vector<FrozenLayout::Scalar> elements;
+            elements.reserve(va.size());
+            for (unsigned i = 0; i < va.size(); i++) {
+                elements.push_back(scalar(va.at(i)));
+            }
+            const std::size_t bytes = sizeof(FrozenLayout::Array) +
+                elements.size() * sizeof(FrozenLayout::Scalar);
+            const std::uint32_t offset =
+                reserve(bytes, alignof(FrozenLayout::Scalar));
+            FrozenLayout::Array* a = at<FrozenLayout::Array>(offset);
+            a->size = static_cast<std::uint32_t>(elements.size());
+            a->conformable = 0;
+            if (va.is_conformable_to_string) {
+                a->conformable |= FrozenLayout::TO_STRING;
+            }
+            if (va.is_conformable_to_integer) {
+                a->conformable |= FrozenLayout::TO_INTEGER;
+            }
+            if (va.is_conformable_to_float) {
+                a->conformable |= FrozenLayout::TO_FLOAT;
+            }
+            if (va.is_conformable_to_boolean) {
+                a->conformable |= FrozenLayout::TO_BOOLEAN;
+            }
+            if (!elements.empty()) {
+                std::memcpy(a + 1, elements.data(),
+                        elements.size() * sizeof(FrozenLayout::Scalar));
+            }
+            return offset;
+        }
+
+        // A Table: its elements, then its Record, Entries, and index
+        std::uint32_t table(const Table& t) {
+            const Table::Data& d = *t.data;
+
+            // The Entries sorted by key (and kind, for a key used twice)
+            std::vector<std::uint32_t> order(d.entries.size());
+            for (std::size_t e = 0; e < order.size(); e++) {
+                order[e] = static_cast<std::uint32_t>(e);
+            }
+            std::sort(order.begin(), order.end(),
+                    [&](const std::uint32_t a, const std::uint32_t b) {
+                const Table::Entry& x = d.entries[a];
+                const Table::Entry& y = d.entries[b];
+                const int c = std::memcmp(x.key, y.key,
+                        std::min(x.size, y.size));
+                if (c != 0) {
+                    return (c < 0);
+                }
+                return (x.size != y.size) ? (x.size < y.size) :
+                    (x.kind < y.kind);
+            });
+
+            std::vector<FrozenLayout::Entry> entries(order.size());
+            for (std::size_t i = 0; i < order.size(); i++) {
+                const Table::Entry& from = d.entries[order[i]];
+                FrozenLayout::Entry& to = entries[i];
+                to.key = key(from.key, from.size);
+                to.size = from.size;
+                to.hash = from.hash;
+                if (from.kind == Table::SCALAR) {
+                    to.kind = FrozenLayout::SCALAR;
+                    const FrozenLayout::Scalar s =
+                        scalar(d.scalars[from.slot]);
+                    to.element = reserve(sizeof(s), alignof(s));
+                    *at<FrozenLayout::Scalar>(to.element) = s;
+                } else if (from.kind == Table::ARRAY) {
+                    to.kind = FrozenLayout::ARRAY;
+                    to.element = array(d.arrays[from.slot]);
+                } else {
+                    to.kind = FrozenLayout::TABLE;
+                    to.element = table(d.tables[from.slot]);
+                }
+            }
+
+            // The index, at most half full, as in a Table
+            std::size_t bucket_count = 0;
+            if (!entries.empty()) {
+                bucket_count = 8;
+                while (bucket_count < 2 * entries.size()) {
+                    bucket_count *= 2;
+                }
+            }
+            std::vector<FrozenLayout::Bucket> buckets(bucket_count);
+            const std::size_t mask = bucket_count - 1;
+            for (std::size_t e = 0; e < entries.size(); e++) {
+                std::size_t i = entries[e].hash & mask;
+                while (buckets[i].entry != 0) {
+                    i = (i + 1) & mask;
+                }
+                buckets[i].hash = entries[e].hash;
+                buckets[i].entry = static_cast<std::uint32_t>(e + 1);
+            }
+
+            const std::size_t entry_bytes =
+                entries.size() * sizeof(FrozenLayout::Entry);
+            const std::size_t bucket_bytes =
+                buckets.size() * sizeof(FrozenLayout::Bucket);
+            const std::uint32_t offset = reserve(sizeof(FrozenLayout::Record)
+                    + entry_bytes + bucket_bytes,
+                    alignof(FrozenLayout::Record));
+            FrozenLayout::Record* r = at<FrozenLayout::Record>(offset);
+            r->size = static_cast<std::uint32_t>(entries.size());
+            r->buckets = static_cast<std::uint32_t>(buckets.size());
+            char* next = reinterpret_cast<char*>(r + 1);
+            if (entry_bytes != 0) {
+                std::memcpy(next, entries.data(), entry_bytes);
+                std::memcpy(next + entry_bytes, buckets.data(), bucket_bytes);
+            }
+            return offset;
+        }
+
+    public:
+        // The buffer of a FrozenTable
+        static const char* buffer_of(const FrozenTable& t) {
+            return t.base;
+        }
+
+        // Read a buffer that was frozen before (e.g. by another process)
+        // after checking that it is whole, and share the ownership of it
+        static bool adopt(const std::shared_ptr<const char>& storage,
+                const std::size_t bytes, FrozenTable& table) {
+            const char* base = storage.get();
+            FrozenLayout::Header header;
+            if (bytes < sizeof(header) ||
+                    reinterpret_cast<std::uintptr_t>(base) %
+                    alignof(FrozenLayout::Scalar) != 0) {
+                return false;
+            }
+            std::memcpy(&header, base, sizeof(header));
+            if (std::memcmp(header.magic, frozen_magic,
+                        sizeof(frozen_magic)) != 0 ||
+                    header.bytes != bytes ||
+                    header.root > bytes - sizeof(FrozenLayout::Record) ||
+                    header.root % alignof(FrozenLayout::Record) != 0) {
+                return false;
+            }
+            table = FrozenTable(base, header.root);
+            table.storage = storage;
+            return true;
+        }
+
+        FrozenTable freeze(const Table& t) {
+            reserve(sizeof(FrozenLayout::Header),
+                    alignof(FrozenLayout::Header));
+            const std::uint32_t root = table(t);
+            FrozenLayout::Header* header = at<FrozenLayout::Header>(0);
+            std::memcpy(header->magic, frozen_magic, sizeof(frozen_magic));
+            header->bytes = static_cast<std::uint32_t>(buffer.size());
+            header->root = root;
+
+            // The FrozenTable owns the buffer through the vector
+            std::shared_ptr<std::vector<char> > owner =
+                std::make_shared<std::vector<char> >();
+            owner->swap(buffer);
+            FrozenTable frozen(owner->data(), root);
+            frozen.storage = std::shared_ptr<const char>(owner, owner->data());
+            return frozen;
+        }
+};
+
+// ----------------------------------------------------------------------------
+
+// Pack the Table into a FrozenTable
+TOML::FrozenTable TOML::Table::freeze() const {
+    FrozenWriter writer;
+    return writer.freeze(*this);
+}
+
+// ----------------------------------------------------------------------------
+
+TOML::FrozenTable::FrozenTable():
+    base(reinterpret_cast<const char*>(&empty_frozen)),
+    record(&empty_frozen.record)
+{}
+
+// ----------------------------------------------------------------------------
+
+// A FrozenTable that points at a Record of a buffer, without owning it
+TOML::FrozenTable::FrozenTable(const char* base, const std::uint32_t record):
+    base(base),
+    record(reinterpret_cast<const FrozenLayout::Record*>(base + record))
+{}
+
+// ----------------------------------------------------------------------------
+
+std::size_t TOML::FrozenTable::bytes() const {
+    return reinterpret_cast<const FrozenLayout::Header*>(base)->bytes;
+}
+
+// ----------------------------------------------------------------------------
+
+const TOML::FrozenLayout::Entry* TOML::FrozenTable::entries() const {
+    return reinterpret_cast<const FrozenLayout::Entry*>(record + 1);
+}
+
+// ----------------------------------------------------------------------------
+
+// Find the Entry for a key of the given kind (or of any kind)
+const TOML::FrozenLayout::Entry* TOML::FrozenTable::find(const KeyView key,
+        const std::uint32_t hash, const FrozenLayout::Kind kind) const {
+    if (record->buckets == 0) {
+        return nullptr;
+    }
+    const FrozenLayout::Entry* e = entries();
+    const FrozenLayout::Bucket* buckets =
+        reinterpret_cast<const FrozenLayout::Bucket*>(e + record->size);
+    const std::size_t mask = record->buckets - 1;
+    for (std::size_t i = hash & mask; buckets[i].entry != 0;
+            i = (i + 1) & mask) {
+        if (buckets[i].hash != hash) {
+            continue;
+        }
+        const FrozenLayout::Entry& entry = e[buckets[i].entry - 1];
+        if ((kind == FrozenLayout::ANY || entry.kind == kind) &&
+                entry.size == key.size() &&
+                std::memcmp(base + entry.key, key.data(), key.size()) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const TOML::FrozenLayout::Entry* TOML::FrozenTable::find(const KeyView key,
+        const FrozenLayout::Kind kind) const {
+    return find(key, hash_key(key.data(), key.size()), kind);
+}
+
+const TOML::FrozenLayout::Entry* TOML::FrozenTable::find(
+        const StaticKey& key, const FrozenLayout::Kind kind) const {
+    return find(key.name(), key.key_hash, kind);
+}
+
+// ----------------------------------------------------------------------------
+
+// The element of an Entry (raising the same errors as a Table if it is
+// missing)
+TOML::FrozenValue TOML::FrozenTable::scalar(const FrozenLayout::Entry* e,
+        const KeyView key) const {
+    if (e == nullptr) {
+        missing_element("scalar", key);
+    }
+    return FrozenValue(base,
+            reinterpret_cast<const FrozenLayout::Scalar*>(base + e->element));
+}
+
+TOML::FrozenArray TOML::FrozenTable::array(const FrozenLayout::Entry* e,
+        const KeyView key) const {
+    if (e == nullptr) {
+        missing_element("array", key);
+    }
+    return FrozenArray(base,
+            reinterpret_cast<const FrozenLayout::Array*>(base + e->element));
+}
+
+TOML::FrozenTable TOML::FrozenTable::table(const FrozenLayout::Entry* e,
+        const KeyView key) const {
+    if (e == nullptr) {
+        missing_element("table", key);
+    }
+    return FrozenTable(base, e->element);
+}
+
+// ----------------------------------------------------------------------------
+
+// The keys of one kind (the Entries are already sorted)
+std::vector<std::string> TOML::FrozenTable::keys(
+        const FrozenLayout::Kind kind) const {
+    std::vector<std::string> v;
+    const FrozenLayout::Entry* e = entries();
+    for (std::uint32_t i = 0; i < record->size; i++) {
+        if (e[i].kind == kind) {
+            v.push_back(std::string(base + e[i].key, e[i].size));
+        }
+    }
+    return v;
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the set of all keys in the Table (as for a Table, the scalars and
+// arrays)
+std::vector<std::string> TOML::FrozenTable::all_keys() const {
+    std::vector<std::string> v = scalar_keys();
+    std::vector<std::string> arrays = array_keys();
+    v.insert(v.end(), arrays.begin(), arrays.end());
+    return v;
+}
+
+std::vector<std::string> TOML::FrozenTable::scalar_keys() const {
+    return keys(FrozenLayout::SCALAR);
+}
+
+std::vector<std::string> TOML::FrozenTable::array_keys() const {
+    return keys(FrozenLayout::ARRAY);
+}
+
+std::vector<std::string> TOML::FrozenTable::table_keys() const {
+    return keys(FrozenLayout::TABLE);
+}
+
+// ----------------------------------------------------------------------------
+
+// Does the Table have an element with this key?
+bool TOML::FrozenTable::has(const KeyView key) const {
+    return (find(key, FrozenLayout::ANY) != nullptr);
+}
+
+bool TOML::FrozenTable::has(const StaticKey& key) const {
+    return (find(key, FrozenLayout::ANY) != nullptr);
+}
+
+bool TOML::FrozenTable::has_scalar(const KeyView key) const {
+    return (find(key, FrozenLayout::SCALAR) != nullptr);
+}
+
+bool TOML::FrozenTable::has_scalar(const StaticKey& key) const {
+    return (find(key, FrozenLayout::SCALAR) != nullptr);
+}
+
+bool TOML::FrozenTable::has_array(const KeyView key) const {
+    return (find(key, FrozenLayout::ARRAY) != nullptr);
+}
+
+bool TOML::FrozenTable::has_array(const StaticKey& key) const {
+    return (find(key, FrozenLayout::ARRAY) != nullptr);
+}
+
+bool TOML::FrozenTable::has_table(const KeyView key) const {
+    return (find(key, FrozenLayout::TABLE) != nullptr);
+}
+
+bool TOML::FrozenTable::has_table(const StaticKey& key) const {
+    return (find(key, FrozenLayout::TABLE) != nullptr);
+}
+
+// ----------------------------------------------------------------------------
+
+// Does the Table have an element with this path?
+bool TOML::FrozenTable::has(const std::vector<std::string>& path) const {
+    FrozenTable current_table(base, 0);  // (Without sharing the buffer)
+    current_table.record = record;
+    for (unsigned index = 0; index < path.size(); index++) {
+        if (index == path.size() - 1) {
+            return current_table.has(path[index]);
+        }
+        const FrozenLayout::Entry* e =
+            current_table.find(path[index], FrozenLayout::TABLE);
+        if (e == nullptr) {
+            return false;
+        }
+        current_table.record = reinterpret_cast<const FrozenLayout::Record*>(
+                base + e->element);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+// Access an element according to its key within the Table
+TOML::FrozenValue TOML::FrozenTable::get_scalar(const KeyView key) const {
+    return scalar(find(key, FrozenLayout::SCALAR), key);
+}
+
+TOML::FrozenValue TOML::FrozenTable::get_scalar(const StaticKey& key) const {
+    return scalar(find(key, FrozenLayout::SCALAR), key.name());
+}
+
+TOML::FrozenArray TOML::FrozenTable::get_array(const KeyView key) const {
+    return array(find(key, FrozenLayout::ARRAY), key);
+}
+
+TOML::FrozenArray TOML::FrozenTable::get_array(const StaticKey& key) const {
+    return array(find(key, FrozenLayout::ARRAY), key.name());
+}
+
+TOML::FrozenTable TOML::FrozenTable::get_table(const KeyView key) const {
+    return table(find(key, FrozenLayout::TABLE), key);
+}
+
+TOML::FrozenTable TOML::FrozenTable::get_table(const StaticKey& key) const {
+    return table(find(key, FrozenLayout::TABLE), key.name());
+}
+
+// ----------------------------------------------------------------------------
+
+// Find a subtable from a path
+TOML::FrozenTable TOML::FrozenTable::get_table(
+        const std::vector<std::string>& path) const {
+    FrozenTable current_table(base, 0);  // (Without sharing the buffer)
+    current_table.record = record;
+    for (auto it = path.begin(); it != path.end(); it++) {
+        current_table.record = current_table.table(
+                current_table.find(*it, FrozenLayout::TABLE), *it).record;
+    }
+    return current_table;
+}
+
+// ----------------------------------------------------------------------------
+
+// Convert the Table to a std::string in the same way as a Table
+std::string TOML::FrozenTable::serialize(unsigned indent_level) const {
+    std::string indent("");
+    for (unsigned i = 0; i < indent_level; i++) {
+        indent += "    ";
+    }
+    std::stringstream ss("");
+    const FrozenLayout::Entry* e = entries();
+    for (std::uint32_t i = 0; i < record->size; i++) {
+        if (e[i].kind == FrozenLayout::SCALAR) {
+            ss << indent;
+            ss.write(base + e[i].key, e[i].size);
+            ss << " = " << scalar(&e[i], KeyView("")) << std::endl;
+        }
+    }
+    for (std::uint32_t i = 0; i < record->size; i++) {
+        if (e[i].kind == FrozenLayout::ARRAY) {
+            ss << indent;
+            ss.write(base + e[i].key, e[i].size);
+            ss << " = " << array(&e[i], KeyView("")) << std::endl;
+        }
+    }
+    for (std::uint32_t i = 0; i < record->size; i++) {
+        if (e[i].kind == FrozenLayout::TABLE) {
+            ss << indent << "[";
+            ss.write(base + e[i].key, e[i].size);
+            ss << "]" << std::endl;
+            ss << table(&e[i], KeyView("")).serialize(indent_level+1)
+                << std::endl;
+        }
+    }
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------------
+
+// Write a FrozenTable to a stream
+std::ostream& TOML::operator<< (std::ostream& sout,
+        const TOML::FrozenTable& t) {
+    sout << t.serialize();
+    return sout;
+}
+
+// ----------------------------------------------------------------------------
+
+// Return the scalar as each type (with the same conversions and errors as a
+// Value)
+TOML::String TOML::FrozenValue::as_string() const {
+    if (scalar->type == FrozenLayout::STRING) {
+        return TOML::String(base + scalar->value.text, scalar->size);
     } else {
-        // Not actually a valid Value
-        throw TOML::ValueError("Value cannot be serialized.");
+        throw TOML::TypeError("Value cannot be converted to a string.");
+    }
+}
+
+TOML::Integer TOML::FrozenValue::as_integer() const {
+    if (scalar->type == FrozenLayout::INTEGER) {
+        return scalar->value.integer;
+    } else if (scalar->type == FrozenLayout::FLOAT &&
+            float_is_integer(scalar->value.floating)) {
+        return static_cast<TOML::Integer>(scalar->value.floating);
+    } else {
+        throw TOML::TypeError("Value cannot be converted to an integer.");
+    }
+}
+
+TOML::Float TOML::FrozenValue::as_float() const {
+    if (scalar->type == FrozenLayout::FLOAT) {
+        return scalar->value.floating;
+    } else if (scalar->type == FrozenLayout::INTEGER) {
+        return static_cast<TOML::Float>(scalar->value.integer);
+    } else {
+        throw TOML::TypeError("Value cannot be converted to an integer.");
+    }
+}
+
+TOML::Boolean TOML::FrozenValue::as_boolean() const {
+    if (scalar->type == FrozenLayout::BOOLEAN) {
+        return scalar->value.boolean;
+    } else {
+        throw TOML::TypeError("Value cannot be converted to an boolean.");
     }
 }
 
 // ----------------------------------------------------------------------------
 
-// Write a Value to a stream
-std::ostream& TOML::operator<< (std::ostream& sout, const TOML::Value& v) {
-    sout << v.serialize();
-    return sout;
+bool TOML::FrozenValue::is_valid_string() const {
+    return (scalar->type == FrozenLayout::STRING);
 }
 
-// ============================================================================
-// ValueArray _________________________________________________________________
+bool TOML::FrozenValue::is_valid_integer() const {
+    return (scalar->type == FrozenLayout::INTEGER ||
+            (scalar->type == FrozenLayout::FLOAT &&
+             float_is_integer(scalar->value.floating)));
+}
 
-TOML::ValueArray::ValueArray():
-    is_conformable_to_string(false),
-    is_conformable_to_integer(false),
-    is_conformable_to_float(false),
-    is_conformable_to_boolean(false)
-{}
+bool TOML::FrozenValue::is_valid_float() const {
+    return (scalar->type == FrozenLayout::FLOAT ||
+            scalar->type == FrozenLayout::INTEGER);
+}
+
+bool TOML::FrozenValue::is_valid_boolean() const {
+    return (scalar->type == FrozenLayout::BOOLEAN);
+}
 
 // ----------------------------------------------------------------------------
 
-unsigned TOML::ValueArray::size() const {
-    return array.size();
+// Convert the scalar to a std::string, through a Value so that it is written
+// the same way
+std::string TOML::FrozenValue::serialize() const {
+    TOML::Value v;
+    switch (scalar->type) {
+        case FrozenLayout::STRING: v.set(as_string()); break;
+        case FrozenLayout::INTEGER: v.set(as_integer()); break;
+        case FrozenLayout::FLOAT: v.set(as_float()); break;
+        case FrozenLayout::BOOLEAN: v.set(as_boolean()); break;
+    }
+    return v.serialize();
 }
 
 // ----------------------------------------------------------------------------
 
-void TOML::ValueArray::add(const Value v) {
-    if (array.empty()) {
-        array.push_back(v);
-        is_conformable_to_string = v.is_valid_string();
-        is_conformable_to_integer = v.is_valid_integer();
-        is_conformable_to_float = v.is_valid_float();
-        is_conformable_to_boolean = v.is_valid_boolean();
-    } else {
-        if (is_conformable_to_string && v.is_valid_string()) {
-            array.push_back(v);
-        } else if (is_conformable_to_integer && v.is_valid_integer()) {
-            is_conformable_to_float &= v.is_valid_float();
-            array.push_back(v);
-        } else if (is_conformable_to_float && v.is_valid_float()) {
-            is_conformable_to_integer &= v.is_valid_integer();
-            array.push_back(v);
-        } else if (is_conformable_to_boolean && v.is_valid_boolean()) {
-            array.push_back(v);
-        } else {
-            throw TOML::ValueError(
-                    "Value with invalid type cannot be added to ValueArray.");
-        }
-    }
+// Write a FrozenValue to a stream
+std::ostream& TOML::operator<< (std::ostream& sout,
+        const TOML::FrozenValue& v) {
+    sout << v.serialize();
+    return sout;
 }
 
 // ----------------------------------------------------------------------------
 
-void TOML::ValueArray::remove(const unsigned index) {
-    if (index >= array.size()) {
-        throw std::out_of_range("Out-of-range index in ValueArray.");
-    }
-    array.erase(array.begin()+index);
+const TOML::FrozenLayout::Scalar* TOML::FrozenArray::elements() const {
+    return reinterpret_cast<const FrozenLayout::Scalar*>(array + 1);
 }
 
 // ----------------------------------------------------------------------------
 
-void TOML::ValueArray::clear() {
-    array.clear();
+unsigned TOML::FrozenArray::size() const {
+    return array->size;
 }
 
 // ----------------------------------------------------------------------------
 
-TOML::Value TOML::ValueArray::at(const unsigned index) const {
-    return array.at(index);
+TOML::FrozenValue TOML::FrozenArray::at(const unsigned index) const {
+    if (index >= array->size) {
+        throw std::out_of_range("Out-of-range index in FrozenArray.");
+    }
+    return FrozenValue(base, elements() + index);
 }
 
 // ----------------------------------------------------------------------------
 
-std::vector<TOML::String> TOML::ValueArray::as_string() const {
-    if (is_conformable_to_string) {
+// Return the elements as each type (with the same errors as a ValueArray)
+std::vector<TOML::String> TOML::FrozenArray::as_string() const {
+    if (array->conformable & FrozenLayout::TO_STRING) {
         std::vector<TOML::String> v;
-        for (auto it = array.begin(); it != array.end(); it++) {
-            v.push_back(it->as_string());
+        for (std::uint32_t i = 0; i < array->size; i++) {
+            v.push_back(FrozenValue(base, elements() + i).as_string());
         }
         return v;
     } else {
@@ -698,13 +5287,11 @@ std::vector<TOML::String> TOML::ValueArray::as_string() const {
     }
 }
 
-// ----------------------------------------------------------------------------
-
-std::vector<TOML::Integer> TOML::ValueArray::as_integer() const {
-    if (is_conformable_to_integer) {
+std::vector<TOML::Integer> TOML::FrozenArray::as_integer() const {
+    if (array->conformable & FrozenLayout::TO_INTEGER) {
         std::vector<TOML::Integer> v;
-        for (auto it = array.begin(); it != array.end(); it++) {
-            v.push_back(it->as_integer());
+        for (std::uint32_t i = 0; i < array->size; i++) {
+            v.push_back(FrozenValue(base, elements() + i).as_integer());
         }
         return v;
     } else {
@@ -712,13 +5299,11 @@ std::vector<TOML::Integer> TOML::ValueArray::as_integer() const {
     }
 }
 
-// ----------------------------------------------------------------------------
-
-std::vector<TOML::Float> TOML::ValueArray::as_float() const {
-    if (is_conformable_to_float) {
+std::vector<TOML::Float> TOML::FrozenArray::as_float() const {
+    if (array->conformable & FrozenLayout::TO_FLOAT) {
         std::vector<TOML::Float> v;
-        for (auto it = array.begin(); it != array.end(); it++) {
-            v.push_back(it->as_float());
+        for (std::uint32_t i = 0; i < array->size; i++) {
+            v.push_back(FrozenValue(base, elements() + i).as_float());
         }
         return v;
     } else {
@@ -726,13 +5311,11 @@ std::vector<TOML::Float> TOML::ValueArray::as_float() const {
     }
 }
 
-// ----------------------------------------------------------------------------
-
-std::vector<TOML::Boolean> TOML::ValueArray::as_boolean() const {
-    if (is_conformable_to_boolean) {
+std::vector<TOML::Boolean> TOML::FrozenArray::as_boolean() const {
+    if (array->conformable & FrozenLayout::TO_BOOLEAN) {
         std::vector<TOML::Boolean> v;
-        for (auto it = array.begin(); it != array.end(); it++) {
-            v.push_back(it->as_boolean());
+        for (std::uint32_t i = 0; i < array->size; i++) {
+            v.push_back(FrozenValue(base, elements() + i).as_boolean());
         }
         return v;
     } else {
@@ -742,13 +5325,13 @@ std::vector<TOML::Boolean> TOML::ValueArray::as_boolean() const {
 
 // ----------------------------------------------------------------------------
 
-std::string TOML::ValueArray::serialize() const {
+std::string TOML::FrozenArray::serialize() const {
     std::stringstream ss("");
     ss << "[";
-    if (!array.empty()) {
-        ss << array[0];
-        for (auto it = array.begin() + 1; it != array.end(); it++) {
-            ss << ", " << *it;
+    if (array->size != 0) {
+        ss << at(0);
+        for (std::uint32_t i = 1; i < array->size; i++) {
+            ss << ", " << at(i);
         }
     } else {
         ss << " ";
@@ -759,395 +5342,330 @@ std::string TOML::ValueArray::serialize() const {
 
 // ----------------------------------------------------------------------------
 
-// Write a ValueArray to a stream
-std::ostream& TOML::operator<< (
-        std::ostream& sout, const TOML::ValueArray& va) {
+// Write a FrozenArray to a stream
+std::ostream& TOML::operator<< (std::ostream& sout,
+        const TOML::FrozenArray& va) {
     sout << va.serialize();
     return sout;
 }
 
 // ============================================================================
-// Table ______________________________________________________________________
-
-// Parse a Table from an input string
-// -- This is a convenience method that wraps parse_stream
-void TOML::Table::parse_string(const std::string s) {
-    // Load into a stringstream and parse that stream
-    std::istringstream iss(s);
-    parse_stream(iss);
-}
-
-// ----------------------------------------------------------------------------
+// Config handle ______________________________________________________________
 
-// Parse a Table from a file (specified by the file name)
-// -- This is a convenience method that wraps parse_stream
-void TOML::Table::parse_file(const std::string filename) {
-    // Open the file as a filestream and parse that stream
-    std::ifstream fin;
-    fin.open(filename);
-    parse_stream(fin);
-    fin.close();    // Don't forget to close the file!
+// The stripe of the calling thread (threads are given stripes in turn)
+static unsigned reader_stripe(const unsigned stripe_count) {
+    static std::atomic<unsigned> next_stripe(0);
+    static thread_local unsigned stripe = next_stripe.fetch_add(1);
+    return stripe % stripe_count;
 }
 
 // ----------------------------------------------------------------------------
 
-// Parse a Table from a stream.  A failure results in a ParseError, and clears
-// the Table.
-void TOML::Table::parse_stream(std::istream& sin) {
-    clear();
-    Table* current_table = this;
-    std::string line;
-    // Loop over each line of the stream
-    try {
-        while(std::getline(sin,line)) {
-            string_it it = line.begin();
-            const string_it end = line.end();
-            // Strip leading whitespace
-            consume_whitespace(it, end);
-            // What kind of line is it?
-            if (it == end || *it == comment) {
-                // If the line is empty or is comment-only, skip it
-                continue;
-            } else if (*it == '[') {
-                // This is the start of a new Table
-                // Note: All paths from a file will be specified from the root
-                //       table, which is the Table doing the processing.
-                consume_character('[', it, end);
-                std::vector<std::string> path = analyze_table_name(it, end);
-                consume_character(']', it, end);
-                consume_to_eol(it, end);
-                // The TOML standard does not allow re-entering a Table after
-                // you've already created it and then moved to another Table.
-                // Thus we generate an error if the Table already exists.
-                // TODO -- The TOML standard actually allows a slightly more
-                //         complex behavior: If you define Table [a.b], you can
-                //         then go back and fill in Table [a] so long as [a]
-                //         only exists because you built it as an intermediary
-                //         to build [a.b].  Thus I will need a more-complex
-                //         bookkeeping mechanism to specify whether a Table
-                //         exists because it was directly defined or because it
-                //         was built as an intermediary.
-                if (this->has(path)) {
-                    std::string message = "Key \"";
-                    for (unsigned index = 0; index < path.size()-1; index++) {
-                        message += path[index] + ".";
-                    }
-                    message += path[path.size()-1] + "\" is not unique.";
-                    throw ParseError(message);
-                }
-                // Create the Table (and all intermediaries)
-                current_table = &(this->get_table(path, true));
-            } else {
-                // This is a key pair
-                std::string key = analyze_key(it, end);
-                if (current_table->has(key)) {
-                    throw ParseError("Key \"" + key + "\" is not unique.");
-                }
-                consume_whitespace(it, end);
-                consume_character('=', it, end);
-                consume_whitespace(it, end);
-                if (*it == '[') {
-                    // This is a ValueArray
-                    TOML::ValueArray va;
-                    consume_character('[', it, end);
-                    consume_whitespace(it, end);
-                    while (*it != ']') {
-                        va.add(TOML::Value(it, end));
-                        consume_whitespace(it, end);
-                        if (*it == ',') {
-                            consume_character(',', it, end);
-                            consume_whitespace(it, end);
-                        } else if (*it != ']') {
-                            throw TOML::ParseError(
-                                    "Malformed array of values.");
-                        }
-                    }
-                    consume_character(']', it, end);
-                    consume_to_eol(it, end);
-                    current_table->add(key, va);
-                } else {
-                    // This is a Value
-                    TOML::Value v(it, end);
-                    consume_to_eol(it, end);
-                    current_table->add(key, v);
-                }
-            }
-        }
-    } catch (TOML::ParseError& pe) {
-        clear();
-        throw;
+TOML::ConfigHandle::ConfigHandle(const std::string filename,
+        const ParseOptions& options):
+    filename(filename),
+    options(options),
+    current(nullptr),
+    generation(0),
+    version_count(0)
+{
+    for (unsigned s = 0; s < stripe_count; s++) {
+        stripes[s].readers[0].store(0);
+        stripes[s].readers[1].store(0);
     }
+    reload();
 }
 
 // ----------------------------------------------------------------------------
 
-bool TOML::Table::valid_key(const std::string key) {
-    string_it it = key.begin();
-    const string_it end = key.end();
-    try {
-        analyze_key(it, end);
-    } catch(TOML::ParseError& pe) {
-        return false;
-    }
-    if (it == end) {
-        return true;
-    } else {
-        return false;
-    }
+TOML::ConfigHandle::~ConfigHandle() {
+    delete current.load();
 }
 
 // ----------------------------------------------------------------------------
 
-// Add a Value to the Table
-void TOML::Table::add(const std::string key, const Value& v) {
-    if (scalar_map.find(key) != scalar_map.end()) {
-        throw TOML::TableError("Key \"" + key + "\" already exists.");
-    }
-    if (!valid_key(key)) {
-        throw TOML::TableError("Key \"" + key + "\" is invalid.");
-    }
-    scalar_map[key] = v;
+// Take a Snapshot of the current version.  The reader is counted before the
+// pointer is loaded, so a version it loads cannot be freed until it is done.
+TOML::ConfigHandle::Snapshot TOML::ConfigHandle::read() {
+    Stripe& stripe = stripes[reader_stripe(stripe_count)];
+    std::atomic<long>& readers = stripe.readers[generation.load() & 1];
+    readers.fetch_add(1);
+    return Snapshot(&readers, current.load());
 }
 
 // ----------------------------------------------------------------------------
 
-// Add a ValueArray to the Table
-void TOML::Table::add(const std::string key, const ValueArray& va) {
-    if (array_map.find(key) != array_map.end()) {
-        throw TOML::TableError("Key \"" + key + "\" already exists.");
-    }
-    if (!valid_key(key)) {
-        throw TOML::TableError("Key \"" + key + "\" is invalid.");
+// Wait for the readers of both parities to finish, one parity at a time.
+// New readers are counted under the other parity while the writer waits, so
+// they cannot hold it up; and after both rounds every reader that started
+// before the new version was published (whichever parity it took) has
+// finished.
+void TOML::ConfigHandle::synchronize() {
+    for (unsigned round = 0; round < 2; round++) {
+        const unsigned parity = generation.fetch_add(1) & 1;
+        for (unsigned s = 0; s < stripe_count; s++) {
+            while (stripes[s].readers[parity].load() != 0) {
+                std::this_thread::yield();
+            }
+        }
     }
-    array_map[key] = va;
 }
 
 // ----------------------------------------------------------------------------
 
-// Add a sub-Table to the Table
-void TOML::Table::add(const std::string key, const Table& t) {
-    if (this == &t) {
-        throw TOML::TableError("Cannot have recursive tables.");
-    }
-    if (table_map.find(key) != table_map.end()) {
-        throw TOML::TableError("Key \"" + key + "\" already exists.");
-    }
-    if (!valid_key(key)) {
-        throw TOML::TableError("Key \"" + key + "\" is invalid.");
-    }
-    table_map[key] = t;
+// Parse the file into a Table of its own (so that a ParseError leaves the
+// current version alone) and publish it
+void TOML::ConfigHandle::reload() {
+    Table table;
+    table.parse_file(filename, options);
+    publish(table);
 }
 
 // ----------------------------------------------------------------------------
 
-// Return the set of all keys in the Table
-std::vector<std::string> TOML::Table::all_keys() const {
-    std::vector<std::string> v;
-    for (auto it = scalar_map.begin(); it != scalar_map.end(); it++) {
-        v.push_back(it->first);
-    }
-    for (auto it = array_map.begin(); it != array_map.end(); it++) {
-        v.push_back(it->first);
-    }
-    return v;
+// Freeze the Table and swap it in, then free the old version once nothing
+// can be reading it
+void TOML::ConfigHandle::publish(const Table& table) {
+    std::unique_ptr<const FrozenTable> fresh(
+            new FrozenTable(table.freeze()));
+    std::lock_guard<std::mutex> lock(writer);
+    const FrozenTable* old = current.exchange(fresh.release());
+    version_count.fetch_add(1);
+    synchronize();
+    delete old;
 }
 
 // ----------------------------------------------------------------------------
 
-// Return the set of keys to scalars in the Table
-std::vector<std::string> TOML::Table::scalar_keys() const {
-    std::vector<std::string> v;
-    for (auto it = scalar_map.begin(); it != scalar_map.end(); it++) {
-        v.push_back(it->first);
-    }
-    return v;
+unsigned long TOML::ConfigHandle::version() const {
+    return version_count.load();
 }
 
-// ----------------------------------------------------------------------------
-
-// Return the set of keys to arrays in the Table
-std::vector<std::string> TOML::Table::array_keys() const {
-    std::vector<std::string> v;
-    for (auto it = array_map.begin(); it != array_map.end(); it++) {
-        v.push_back(it->first);
-    }
-    return v;
-}
+// ============================================================================
+// Binary cache _______________________________________________________________
+
+// The start of a cache file (with no padding); the buffer of the FrozenTable
+// follows it
+struct CacheHeader {
+    char magic[8];
+    std::uint32_t byte_order;   // 0x01020304 as this machine writes it
+    std::uint32_t layout;       // The sizes of the frozen records
+    std::uint64_t source_size;
+    std::int64_t source_seconds;
+    std::int64_t source_nanoseconds;
+    std::uint64_t source_hash;
+    std::uint64_t frozen_bytes;
+};
+
+static const char cache_magic[8] = {'T', 'O', 'M', 'L', 'B', 'I', 'N', '2'};
 
 // ----------------------------------------------------------------------------
 
-// Return the set of keys to tables in the Table
-std::vector<std::string> TOML::Table::table_keys() const {
-    std::vector<std::string> v;
-    for (auto it = table_map.begin(); it != table_map.end(); it++) {
-        v.push_back(it->first);
+#ifdef TOML_HAVE_MMAP
+// Fill in the header a cache of the file should have (all but the hash of
+// the contents and the size of the buffer), or return false if the file
+// cannot be found
+static bool expected_header(const std::string& filename,
+        CacheHeader& header) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) {
+        return false;
     }
-    return v;
-}
-
-// ----------------------------------------------------------------------------
-
-// Does the Table have an element with this key?
-bool TOML::Table::has(const std::string key) const {
-    return (has_scalar(key) || has_array(key) || has_table(key));
-}
-
-// ----------------------------------------------------------------------------
-
-// Does the Table have a scalar Value with this key?
-bool TOML::Table::has_scalar(const std::string key) const {
-    return (scalar_map.find(key) != scalar_map.end());
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.byte_order = 0x01020304u;
+    header.layout = sizeof(TOML::FrozenLayout::Scalar) << 16 |
+        sizeof(TOML::FrozenLayout::Entry) << 8 |
+        sizeof(TOML::FrozenLayout::Header);
+    header.source_size = info.st_size;
+    header.source_seconds = info.st_mtime;
+#ifdef __APPLE__
+    header.source_nanoseconds = info.st_mtimespec.tv_nsec;
+#else
+    header.source_nanoseconds = info.st_mtim.tv_nsec;
+#endif
+    return true;
 }
 
 // ----------------------------------------------------------------------------
 
-// Does the Table have a ValueArray with this key?
-bool TOML::Table::has_array(const std::string key) const {
-    return (array_map.find(key) != array_map.end());
+// Write a cache file through a temporary file (named for this process and
+// thread), or leave things as they were if it cannot be written
+static void write_cache(const std::string& cache_name,
+        const CacheHeader& header, const char* buffer) {
+    std::ostringstream temporary;
+    temporary << cache_name << "." << getpid() << "."
+        << std::hash<std::thread::id>()(std::this_thread::get_id())
+        << ".tmp";
+    const std::string name = temporary.str();
+    bool written;
+    {
+        std::ofstream fout(name, std::ios::binary);
+        fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        fout.write(buffer, header.frozen_bytes);
+        fout.close();
+        written = !fout.fail();
+    }
+    if (!written || std::rename(name.c_str(), cache_name.c_str()) != 0) {
+        std::remove(name.c_str());
+    }
 }
+#endif
 
 // ----------------------------------------------------------------------------
 
-// Does the Table have a Table with this key?
-bool TOML::Table::has_table(const std::string key) const {
-    return (table_map.find(key) != table_map.end());
-}
-
-// ----------------------------------------------------------------------------
+// Read a file through its cache, or parse it (and write the cache)
+TOML::FrozenTable TOML::parse_file_cached(const std::string filename,
+        const ParseOptions& options) {
+#ifdef TOML_HAVE_MMAP
+    CacheHeader expected;
+    if (expected_header(filename, expected)) {
+        // Check the header against the size and modification time of the
+        // file first, so that a stale cache is turned down without reading
+        // the file
+        const std::string cache_name = filename + ".bin";
+        std::shared_ptr<MappedFile> cache =
+            std::make_shared<MappedFile>(cache_name);
+        const std::size_t length = cache->end() - cache->begin();
+        CacheHeader found;
+        bool fresh = false;
+        if (cache->begin() != nullptr && length >= sizeof(found)) {
+            std::memcpy(&found, cache->begin(), sizeof(found));
+            fresh = (std::memcmp(&found, &expected,
+                        offsetof(CacheHeader, source_hash)) == 0 &&
+                    found.frozen_bytes == length - sizeof(found));
+        }
 
-// Does the Table have an element with this path?
-bool TOML::Table::has(const std::vector<std::string> path) const {
-    const Table* current_table = this;
-    for (unsigned index = 0; index < path.size(); index++) {
-        if (current_table->has(path[index])) {
-            if (index != path.size() - 1) {
-                current_table = &(current_table->get_table(path[index]));
+        MappedFile source(filename);
+        if (source.begin() != nullptr) {
+            const std::size_t size = source.end() - source.begin();
+            expected.source_hash = hash_bytes(source.begin(), size);
+
+            // Use the cache if it was made from the contents as they are now
+            FrozenTable table;
+            if (fresh && found.source_hash == expected.source_hash &&
+                    FrozenWriter::adopt(std::shared_ptr<const char>(cache,
+                            cache->begin() + sizeof(found)),
+                        found.frozen_bytes, table)) {
+                return table;
             }
-        } else {
-            return false;
+            cache.reset();
+
+            Table parsed;
+            parsed.parse_buffer(source.begin(), source.end(), options);
+            FrozenTable frozen = parsed.freeze();
+            expected.frozen_bytes = frozen.bytes();
+            write_cache(cache_name, expected,
+                    FrozenWriter::buffer_of(frozen));
+            return frozen;
         }
     }
-    return true;
-}
-
-// ----------------------------------------------------------------------------
-
-// Access a Value according to its key within the Table
-TOML::Value& TOML::Table::get_scalar(const std::string key) {
-    if (scalar_map.find(key) == scalar_map.end()) {
-        std::string message = "No scalar at key \"";
-        message.append(key);
-        message.append("\".");
-        throw TOML::TableError(message);
-    }
-    return scalar_map.at(key);
+#endif
+    // With no file to map there is nothing to cache
+    Table table;
+    table.parse_file(filename, options);
+    return table.freeze();
 }
 
-// ----------------------------------------------------------------------------
-
-// Access a ValueArray according to its key within the Table
-TOML::ValueArray& TOML::Table::get_array(const std::string key) {
-    if (array_map.find(key) == array_map.end()) {
-        std::string message = "No array at key \"";
-        message.append(key);
-        message.append("\".");
-        throw TOML::TableError(message);
-    }
-    return array_map.at(key);
-}
-
-// ----------------------------------------------------------------------------
-
-// Access a Table according to its key within the Table
-TOML::Table& TOML::Table::get_table(const std::string key) {
-    if (table_map.find(key) == table_map.end()) {
-        std::string message = "No table at key \"";
-        message.append(key);
-        message.append("\".");
-        throw TOML::TableError(message);
+// ============================================================================
+// Binding ____________________________________________________________________
+
+// The problems, one after the other, as the message of a BindingError
+static std::string join_problems(const std::vector<std::string>& problems) {
+    std::string message;
+    for (std::size_t index = 0; index < problems.size(); index++) {
+        if (index > 0) {
+            message.append(" ");
+        }
+        message.append(problems[index]);
     }
-    return table_map.at(key);
+    return message;
 }
 
 // ----------------------------------------------------------------------------
 
-// Access a Table according to its key within the Table (const version)
-const TOML::Table& TOML::Table::get_table(const std::string key) const {
-    if (table_map.find(key) == table_map.end()) {
-        std::string message = "No table at key \"";
-        message.append(key);
-        message.append("\".");
-        throw TOML::TableError(message);
-    }
-    return table_map.at(key);
-}
+TOML::BindingError::BindingError(const std::vector<std::string>& problems):
+    Error(join_problems(problems)), problem_list(problems)
+{}
 
 // ----------------------------------------------------------------------------
 
-// Find a subtable from a path.  The create flag specifies whether or not to
-// create table if missing (including intermediate tables).
-TOML::Table& TOML::Table::get_table(
-        const std::vector<std::string> path, const bool create) {
-    Table* current_table = this;
-    for (auto it = path.begin(); it != path.end(); it++) {
-        if (create && !current_table->has(*it)) {
-            // if create is false, we won't add the new table and get_table()
-            // below will generate the appropriate error for a missing key
-            current_table->add(*it, Table());
+// Add a Field, after the last one in the same Table
+void TOML::BindingBase::add_field(const KeyView path, const Type type) {
+    Field field;
+    field.name = path.str();
+    field.table = split_path(path);
+    field.key = field.table.back();
+    field.table.pop_back();
+    field.hash = hash_key(field.key.data(), field.key.size());
+    field.type = type;
+
+    std::size_t position = order.size();
+    for (std::size_t index = 0; index < order.size(); index++) {
+        if (fields[order[index]].table == field.table) {
+            position = index + 1;
         }
-        current_table = &current_table->get_table(*it);
-    }
-    return *current_table;
-}
-
-// ----------------------------------------------------------------------------
-
-// Find a subtable from a path.  This is the const version.
-const TOML::Table& TOML::Table::get_table(
-        const std::vector<std::string> path) const {
-    const Table* current_table = this;
-    for (auto it = path.begin(); it != path.end(); it++) {
-        current_table = &(current_table->get_table(*it));
     }
-    return *current_table;
+    order.insert(order.begin() + position, fields.size());
+    fields.push_back(field);
 }
 
 // ----------------------------------------------------------------------------
 
-// Clear the Table
-void TOML::Table::clear() {
-    scalar_map.clear();
-    array_map.clear();
-    table_map.clear();
-}
-
-// ----------------------------------------------------------------------------
+// Find the Value of every Field
+void TOML::BindingBase::find_values(const Table& table,
+        std::vector<const Value*>& values) const {
+    static const char* const type_names[] = {
+        "a string", "an integer", "a float", "a boolean"
+    };
+    values.assign(fields.size(), nullptr);
+    std::vector<std::string> problems;
+    const Table* current_table = nullptr;
+    const std::vector<std::string>* current_path = nullptr;
+    for (std::size_t index : order) {
+        const Field& field = fields[index];
+
+        // Find the Table, unless the last Field was in it too
+        if (current_path == nullptr || field.table != *current_path) {
+            current_path = &field.table;
+            current_table = &table;
+            for (const std::string& key : field.table) {
+                long e = current_table->find(key, Table::TABLE);
+                if (e == -1) {
+                    current_table = nullptr;
+                    break;
+                }
+                current_table = &current_table->data->tables[
+                    current_table->data->entries[e].slot];
+            }
+        }
 
-// Convert the Table to a std::string as if writing a new TOML file
-std::string TOML::Table::serialize(unsigned indent_level) const {
-    std::string indent("");
-    for (unsigned i = 0; i < indent_level; i++) {
-        indent += "    ";
-    }
-    std::stringstream ss("");
-    for (auto s_it = scalar_map.begin(); s_it != scalar_map.end(); s_it++) {
-        ss << indent << s_it->first << " = " << s_it->second << std::endl;
-    }
-    for (auto a_it = array_map.begin(); a_it != array_map.end(); a_it++) {
-        ss << indent << a_it->first << " = " << a_it->second << std::endl;
+        long e = -1;
+        if (current_table != nullptr) {
+            e = current_table->find(field.key, field.hash, Table::SCALAR);
+        }
+        if (e == -1) {
+            problems.push_back("No scalar at \"" + field.name + "\".");
+            continue;
+        }
+        const Value& value = current_table->data->scalars[
+            current_table->data->entries[e].slot];
+        bool valid = false;
+        switch (field.type) {
+            case STRING: valid = value.is_valid_string(); break;
+            case INTEGER: valid = value.is_valid_integer(); break;
+            case FLOAT: valid = value.is_valid_float(); break;
+            case BOOLEAN: valid = value.is_valid_boolean(); break;
+        }
+        if (!valid) {
+            problems.push_back("The scalar at \"" + field.name + "\" is not "
+                    + type_names[field.type] + ".");
+            continue;
+        }
+        values[index] = &value;
     }
-    for (auto t_it = table_map.begin(); t_it != table_map.end(); t_it++) {
-        ss << indent << "[" << t_it->first << "]" << std::endl;
-        ss << t_it->second.serialize(indent_level+1) << std::endl;
+    if (!problems.empty()) {
+        throw TOML::BindingError(problems);
     }
-    return ss.str();
-}
-
-// ----------------------------------------------------------------------------
-
-// Write a Table to a stream
-std::ostream& TOML::operator<< (std::ostream& sout, const TOML::Table& t) {
-    sout << t.serialize();
-    return sout;
 }
 
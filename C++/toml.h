@@ -7,12 +7,24 @@
 #ifndef TOML_H
 #define TOML_H
 
+#include <atomic>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <sstream>
+#include <stdexcept>
 #include <string>
-#include <boost/container/flat_map.hpp>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#include <boost/container/vector.hpp>
 #include <vector>
 
 namespace TOML {
@@ -46,8 +58,176 @@ namespace TOML {
         bool valid_float;
     } Number;
 
+    // Options that change how a Table is parsed.
+    // -- lazy: Values keep the raw text of their token (its lexical kind is
+    //    known, and its syntax has been checked) and only decode it -- unescape
+    //    a String, or work out a number -- the first time they are read.  The
+    //    decoded value is then kept.  This saves the work for keys that are
+    //    never read, but it means that the first read of a Value changes it,
+    //    so two threads must not make the first read of the same Value at the
+    //    same time.
+    // -- threads: The number of threads used to parse a Table from a string,
+    //    buffer, or file (0 means one per hardware thread).  The document is
+    //    split at its Table headers, the sections are parsed into their own
+    //    Tables at the same time, and those are then moved into place in file
+    //    order, so the result (and the first error, if there is one) is the
+    //    same as with one thread.  Streams and the event interface are always
+    //    read on one thread, as are Tables that live in an Arena.
+    struct ParseOptions {
+        bool lazy;
+        unsigned threads;
+
+        ParseOptions(): lazy(false), threads(1) {}
+    };
+
     // Some typedefs that will be used a lot internally
-    typedef std::string::const_iterator string_it;
+    // -- The parsing routines work on a range of characters [it, end) given by
+    //    plain pointers.  That way the same code can parse a std::string, a
+    //    memory-mapped file, or any other contiguous buffer without copying
+    //    it first.
+    typedef const char* string_it;
+
+    // A lexical token on a line, and the parser that reads lines of them
+    // (both are internal to the parser)
+    struct Token;
+    class LineParser;
+
+    class Table;
+    class BindingBase;
+
+    // The read-only form of a Table, and what freezes a Table into it (which
+    // is internal)
+    class FrozenTable;
+    class FrozenWriter;
+
+    // ========================================================================
+
+    // A monotonic buffer for holding a whole parsed document.  Memory is
+    // handed out by bumping a pointer through large chunks, and is never
+    // returned piece by piece: deallocation is a no-op, and all of the memory
+    // is given back at once by release() (or by the destructor).  This makes a
+    // parse-and-discard loop cost a handful of mallocs instead of one per key,
+    // Value, and string.
+    // -- The Arena must outlive every Table, ValueArray, and Value that was
+    //    built in it.  Copying any of those out of the Arena gives an ordinary
+    //    heap-allocated copy that does not depend on the Arena.
+    // -- The Arena is not thread-safe.
+    class Arena {
+        private:
+            struct Chunk {
+                Chunk* next;
+                std::size_t size;
+            };
+
+            Chunk* chunks;
+            char* current;
+            char* limit;
+            std::size_t next_chunk_size;
+
+            // Not copyable (the chunks are released in the destructor)
+            Arena(const Arena&);
+            Arena& operator= (const Arena&);
+
+        public:
+            explicit Arena(const std::size_t initial_size=4096);
+            ~Arena();
+
+            // Hand out memory
+            void* allocate(const std::size_t bytes,
+                    const std::size_t alignment);
+
+            // Give back all memory at once.  reset() keeps the most recent
+            // (largest) chunk to be reused by the next document.
+            void release();
+            void reset();
+    };
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+    // A standard allocator that takes its memory from an Arena, or from the
+    // heap if it has no Arena.  Copy-constructing a container gives a heap
+    // container (see select_on_container_copy_construction), so that copies
+    // never point back into an Arena that the copy may outlive.
+    template <class T>
+    class ArenaAllocator {
+        public:
+            typedef T value_type;
+
+            Arena* arena;
+
+            ArenaAllocator(): arena(nullptr) {}
+            explicit ArenaAllocator(Arena* a): arena(a) {}
+            template <class U>
+            ArenaAllocator(const ArenaAllocator<U>& other):
+                arena(other.arena) {}
+
+            T* allocate(const std::size_t n) {
+                if (arena == nullptr) {
+                    return static_cast<T*>(::operator new(n * sizeof(T)));
+                }
+                return static_cast<T*>(
+                        arena->allocate(n * sizeof(T), alignof(T)));
+            }
+
+            void deallocate(T* p, const std::size_t /* n */) {
+                if (arena == nullptr) {
+                    ::operator delete(p);
+                }
+            }
+
+            ArenaAllocator select_on_container_copy_construction() const {
+                return ArenaAllocator();
+            }
+    };
+
+    template <class T, class U>
+    bool operator== (const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+        return a.arena == b.arena;
+    }
+
+    template <class T, class U>
+    bool operator!= (const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+        return a.arena != b.arena;
+    }
+
+    // Strings that may live in an Arena (used for keys and String payloads)
+    typedef std::basic_string<char, std::char_traits<char>,
+            ArenaAllocator<char> > ArenaString;
+
+    // Ordering for keys, so that a std::string can be compared with an
+    // ArenaString (and vice versa) without converting it first
+    struct KeyLess {
+        typedef void is_transparent;
+        template <class A, class B>
+        bool operator() (const A& a, const B& b) const {
+            return a.compare(0, a.size(), b.data(), b.size()) < 0;
+        }
+    };
+
+    // A key to look up, in whichever form the caller has it (a std::string, a
+    // C string, or a std::string_view), without copying it into a new string.
+    // It only points at the characters, so it must not outlive them.
+    class KeyView {
+        private:
+            const char* chars;
+            std::size_t length;
+
+        public:
+            KeyView(const char* key): chars(key), length(std::strlen(key)) {}
+            KeyView(const char* key, const std::size_t size):
+                chars(key), length(size) {}
+            template <class A>
+            KeyView(const std::basic_string<char, std::char_traits<char>, A>&
+                    key): chars(key.data()), length(key.size()) {}
+#if __cplusplus >= 201703L
+            KeyView(const std::string_view key):
+                chars(key.data()), length(key.size()) {}
+#endif
+
+            const char* data() const { return chars; }
+            std::size_t size() const { return length; }
+            std::string str() const { return std::string(chars, length); }
+    };
 
     // ========================================================================
 
@@ -86,6 +266,19 @@ namespace TOML {
             ValueError(std::string msg): Error(msg) {}
     };
 
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+    // Raised by a Binding with every problem it found, not just the first
+    class BindingError : public Error {
+        private:
+            std::vector<std::string> problem_list;
+
+        public:
+            explicit BindingError(const std::vector<std::string>& problems);
+            const std::vector<std::string>& problems() const
+                { return problem_list; }
+    };
+
     // ========================================================================
 
     class Value {
@@ -93,26 +286,73 @@ namespace TOML {
             // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
             // Internal storage
 
-            // The value in different formats
-            String value_as_string;
-            Integer value_as_integer;
-            Float value_as_float;
-            Boolean value_as_boolean;
+            // Only one value is ever stored.  The other formats are worked out
+            // from it when they are asked for: an Integer is always
+            // conformable to a Float, and a Float is conformable to an Integer
+            // when it is a whole number that fits in an Integer.  (These are
+            // the same rules that parse_number and set() have always used.)
+            //     A lazily-parsed String or number is held as its raw text,
+            // with the kind RAW_STRING or RAW_NUMBER, until it is first read.
+            enum Kind {
+                EMPTY,
+                STRING,
+                INTEGER,
+                FLOAT,
+                BOOLEAN,
+                RAW_STRING,
+                RAW_NUMBER
+            };
 
-            // Is the value available in the different formats?
-            bool is_conformable_to_string;
-            bool is_conformable_to_integer;
-            bool is_conformable_to_float;
-            bool is_conformable_to_boolean;
+            // Where the characters of a String are kept.  Short strings are
+            // kept inside the Value itself (the small-string optimization).
+            enum Storage {
+                INLINE,
+                HEAP,
+                ARENA
+            };
+
+            static const std::size_t inline_capacity = 16;
+
+            // The value (which member is live depends on kind and storage)
+            // -- These are mutable because decoding a lazy Value on its first
+            //    read replaces the raw text with the decoded value.
+            mutable union {
+                Integer integer;
+                Float floating;
+                Boolean boolean;
+                struct {
+                    char* data;
+                    std::size_t size;
+                } text;
+                char inline_text[inline_capacity];
+            } payload;
+
+            mutable unsigned char kind;
+            mutable unsigned char storage;
+            mutable unsigned char inline_size;
 
             // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
             // Private functions
 
-            // Parsing
+            // String storage
+            bool has_text() const;
+            const char* string_data() const;
+            std::size_t string_size() const;
+            void set_string(const char* data, const std::size_t size,
+                    Arena* arena);
+
+            // Parsing (the parser builds Values straight from Tokens)
+            friend class LineParser;
             void clear();
-            String parse_string(string_it& it, const string_it& end);
-            Number parse_number(string_it& it, const string_it& end);
-            Boolean parse_boolean(string_it& it, const string_it& end);
+            void set_from_token(const Token& token, const string_it& end,
+                    const bool lazy);
+            static Number decode_number(string_it it, const string_it end);
+            void decode() const;
+
+            // A ValueArray keeps Integers, Floats and Booleans unwrapped, and
+            // a FrozenWriter keeps a Float a Float
+            friend class ValueArray;
+            friend class FrozenWriter;
 
         public:
             // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -120,11 +360,25 @@ namespace TOML {
 
             // Constructors
             Value();
+            Value(const Value& v);
+            Value(Value&& v) noexcept;
+            Value(const Value& v, Arena* arena);
+            Value(Value&& v, Arena* arena);
             Value(string_it& it, const string_it& end);
+            Value(std::string::const_iterator& it,
+                    const std::string::const_iterator& end);
             Value(const std::string input_string);
+            ~Value();
+
+            // Assignment
+            Value& operator= (const Value& v);
+            Value& operator= (Value&& v) noexcept;
 
             // Setters
-            void analyze(string_it& it, const string_it& end);
+            void analyze(string_it& it, const string_it& end,
+                    const bool lazy=false);
+            void analyze(std::string::const_iterator& it,
+                    const std::string::const_iterator& end);
             void set_from_string(const std::string input_string);
             void set(const String s);
             void set(const Integer i);
@@ -156,8 +410,30 @@ namespace TOML {
             // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
             // Internal storage
 
-            // Vector to hold all the Values
-            std::vector<Value> array;
+            // How the elements are stored.  An array whose elements are all
+            // Integers, all Floats or all Booleans keeps them as a plain
+            // contiguous block (8 bytes an element, or 1 for a Boolean);
+            // Strings, and numbers that cannot share a block, are kept as
+            // full Values.  Adding a Float to Integers (or an Integer to
+            // Floats) stores every element as a Float when each Integer
+            // converts to one exactly -- so that it reads back the same in
+            // every format -- and falls back to Values otherwise.
+            enum Layout {
+                EMPTY,
+                VALUES,
+                INTEGERS,
+                FLOATS,
+                BOOLEANS
+            };
+
+            unsigned char layout;
+
+            // The elements (only the vector for the layout is in use)
+            std::vector<Value, ArenaAllocator<Value> > array;
+            std::vector<Integer, ArenaAllocator<Integer> > integers;
+            std::vector<Float, ArenaAllocator<Float> > floats;
+            boost::container::vector<Boolean, ArenaAllocator<Boolean> >
+                booleans;
 
             // Are the values available in the different formats?
             bool is_conformable_to_string;
@@ -165,18 +441,37 @@ namespace TOML {
             bool is_conformable_to_float;
             bool is_conformable_to_boolean;
 
+            // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+            // Private functions
+
+            // Raise a ValueError unless the Value can be added, and narrow
+            // down the formats the array is conformable to
+            void check_type(const Value& v);
+
+            // Storage
+            Arena* arena() const;
+            bool add_native(const Value& v);
+            void to_floats();
+            void to_values();
+
+            friend class FrozenWriter;
+
         public:
             // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
             // Public functions
 
             // Constructors
             ValueArray();
+            explicit ValueArray(Arena* arena);
+            ValueArray(const ValueArray& va, Arena* arena);
+            ValueArray(ValueArray&& va, Arena* arena);
 
             // Size of the array
             unsigned size() const;
 
             // Add an element
-            void add(const Value v);
+            void add(const Value& v);
+            void add(Value&& v);
 
             // Remove an element
             void remove(const unsigned index);
@@ -185,6 +480,14 @@ namespace TOML {
             // Access an element
             Value at(const unsigned index) const;
 
+            // The elements as a contiguous block of size() values, without
+            // copying them, or nullptr unless the array is stored that way
+            // (an array of Integers that a Float was added to is stored as
+            // Floats)
+            const Integer* integer_data() const;
+            const Float* float_data() const;
+            const Boolean* boolean_data() const;
+
             // Convert to vector of a specific type
             std::vector<String> as_string() const;
             std::vector<Integer> as_integer() const;
@@ -199,6 +502,139 @@ namespace TOML {
 
     // ========================================================================
 
+    // The keys of a document, each stored once.  Every Table keeps its keys
+    // in a KeyPool, and the Tables of a parsed document (and the sub-Tables
+    // added to them) share one, so a key name that is repeated in many
+    // Tables is stored once and the Tables only point at it.  A KeyPool
+    // only grows; it lives as long as a Table or Symbol that uses it (a
+    // Table that is cleared, or parsed again, starts a new one).  Adding to
+    // a KeyPool takes a lock, so that copies of a Table, which share its
+    // KeyPool, can be changed on different threads.
+    class KeyPool {
+        private:
+            struct Key {
+                const char* chars;
+                std::uint32_t size;
+                std::uint32_t hash;
+            };
+
+            Arena chars;
+            std::vector<Key> keys;
+            // Open addressing over the keys (id plus one, zero if empty)
+            std::vector<std::uint32_t> buckets;
+            std::size_t byte_count;
+            mutable std::mutex guard;
+
+            // Find or add a key, and return its id and where its characters
+            // are kept
+            std::uint32_t intern(const KeyView key, const std::uint32_t hash,
+                    const char*& key_chars);
+
+            friend class Table;
+
+        public:
+            KeyPool();
+
+            // The number of distinct keys, and their total length
+            std::size_t size() const;
+            std::size_t bytes() const;
+    };
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+    // A key that has been looked up in a KeyPool once (with Table::symbol)
+    // so that it can be found again in any Table that uses the pool by its
+    // id, without hashing or comparing the name.  In a Table with another
+    // pool it is looked up by name.
+    class Symbol {
+        private:
+            std::shared_ptr<const KeyPool> pool;
+            std::uint32_t id;
+            std::uint32_t hash;
+            const char* chars;
+            std::uint32_t length;
+
+            friend class Table;
+
+        public:
+            Symbol(): id(0), hash(0), chars(""), length(0) {}
+
+            KeyView name() const { return KeyView(chars, length); }
+    };
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+    // A key whose hash was worked out by the compiler.  Make one from a string
+    // literal with TOML_KEY:
+    //     table.get_table(TOML_KEY("experiment"))
+    //          .get_scalar(TOML_KEY("step_small"));
+    // and it is looked up in the Table's index with no hashing at run time
+    // (the name is still compared, once the hash has matched).
+    class StaticKey {
+        private:
+            const char* chars;
+            std::size_t length;
+            std::uint32_t key_hash;
+
+            friend class Table;
+            friend class FrozenTable;
+
+        public:
+            constexpr StaticKey(const char* chars, const std::size_t size,
+                    const std::uint32_t hash):
+                chars(chars), length(size), key_hash(hash)
+            {}
+
+            KeyView name() const { return KeyView(chars, length); }
+
+            // The hash the Tables use for a key (32-bit FNV-1a), written so
+            // that it can be worked out at compile time
+            static constexpr std::uint32_t hash(const char* key,
+                    const std::size_t size,
+                    const std::uint32_t h=2166136261u) {
+                return (size == 0) ? h : hash(key + 1, size - 1,
+                        (h ^ static_cast<unsigned char>(*key)) * 16777619u);
+            }
+    };
+
+    // The StaticKey for a string literal (the hash is a template argument, so
+    // that it has to be worked out at compile time)
+    #define TOML_KEY(key) (::TOML::StaticKey(key, sizeof(key) - 1, \
+        std::integral_constant<std::uint32_t, \
+            ::TOML::StaticKey::hash(key, sizeof(key) - 1)>::value))
+
+    // ========================================================================
+
+    // A handle to one element of a Table, found once from a dotted path (with
+    // Table::resolve) so that it can be read again and again without looking
+    // up any keys.  It points straight at the element, so it is only valid
+    // until the Tables it was found in are changed (added to, cleared, or
+    // parsed again).
+    class Path {
+        private:
+            // Only the one for the kind of element is set
+            Value* scalar;
+            ValueArray* array;
+            Table* table;
+
+            friend class Table;
+
+        public:
+            Path(): scalar(nullptr), array(nullptr), table(nullptr) {}
+
+            // What kind of element is it?
+            bool is_scalar() const { return scalar != nullptr; }
+            bool is_array() const { return array != nullptr; }
+            bool is_table() const { return table != nullptr; }
+
+            // Access the element (a TableError if it is another kind)
+            Value& get_scalar() const;
+            ValueArray& get_array() const;
+            Table& get_table() const;
+    };
+
+    // ========================================================================
+
     class Table {
         private:
             // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -230,13 +666,126 @@ namespace TOML {
             // pointer, but I'll leave that to you).  But then you have to go
             // through the logic, switch things to use pointers, and make sure
             // you don't introduce memory leaks.  I was too lazy to that yet.
+            //     Later still the three flat_maps (one per kind of element)
+            // became a single hash index over all of the elements, because
+            // has() needed three binary searches and building a wide Table
+            // moved O(n) elements for every key added.  The elements are now
+            // kept in plain vectors in the order they were added (the Tables
+            // in a Boost vector, for the reason above), and the index finds
+            // them by key.  Output is still sorted by key, as it was with the
+            // maps.
+            //     The containers take an ArenaAllocator so that a Table
+            // constructed with an Arena keeps its storage, its keys, and all
+            // of its elements in that Arena.  Without an Arena they use the
+            // heap.
+            //     All of that is held in a Data that copies of the Table
+            // share (copy-on-write), so copying a Table only copies a
+            // pointer.  A Table that is about to be changed first takes its
+            // own copy of the Data if it is shared; that copy holds copies of
+            // the Table's own Values and ValueArrays, but its sub-Tables are
+            // still shared, so only the Tables on the way to a change are
+            // ever copied.  Values and ValueArrays are not shared on their
+            // own: a count on each would cost every read and every parsed
+            // Value, while a Table only copies its own elements (an array of
+            // numbers in one block) when it is changed.  Copies of a Table in
+            // an Arena are deep copies on the heap, as before, so that they
+            // never point into the Arena.
+
+            // The kinds of element (ANY is only used for lookups)
+            enum Kind { SCALAR, ARRAY, TABLE, ANY };
 
-            // The map for (key, value) pairs
-            boost::container::flat_map<std::string,Value> scalar_map;
-            // The map for (key, value array) pairs
-            boost::container::flat_map<std::string,ValueArray> array_map;
-            // The map for (key, table) pairs
-            boost::container::flat_map<std::string,Table> table_map;
+            // An element: its key (which lives in the KeyPool), the hash and
+            // pool id of its key, its kind, and its place in the vector for
+            // that kind
+            struct Entry {
+                const char* key;
+                std::uint32_t size;
+                std::uint32_t hash;
+                std::uint32_t id;
+                Kind kind;
+                std::uint32_t slot;
+            };
+
+            // The hash index: open addressing with linear probing over a
+            // power-of-two number of buckets, kept at most half full.  Each
+            // bucket holds the hash of an Entry (so that most mismatches are
+            // rejected without comparing keys) and its index plus one (zero
+            // marks an empty bucket).
+            struct Bucket {
+                std::uint32_t hash;
+                std::uint32_t entry;
+            };
+
+            // The contents of a Table
+            struct Data {
+                // The pool of keys (nullptr until the first key is added)
+                std::shared_ptr<KeyPool> pool;
+
+                // The elements in the order they were added, and the index
+                std::vector<Entry, ArenaAllocator<Entry> > entries;
+                std::vector<Value, ArenaAllocator<Value> > scalars;
+                std::vector<ValueArray, ArenaAllocator<ValueArray> > arrays;
+                boost::container::vector<Table, ArenaAllocator<Table> >
+                    tables;
+                std::vector<Bucket, ArenaAllocator<Bucket> > buckets;
+
+                explicit Data(Arena* arena);
+                // A copy in the same Arena that shares the sub-Tables
+                Data(const Data& d);
+            };
+
+            // Never nullptr (empty heap Tables share one empty Data)
+            std::shared_ptr<Data> data;
+
+            // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+            // Private functions
+
+            // Copy a Table, putting its keys in the given pool
+            Table(const Table& t, Arena* arena,
+                    const std::shared_ptr<KeyPool>& pool);
+            void copy_contents(const Data& from,
+                    const std::shared_ptr<KeyPool>& pool);
+            // An empty Table in the given Arena and pool
+            Table(Arena* arena, const std::shared_ptr<KeyPool>& pool);
+
+            // A new empty Data in the given Arena, or the shared empty Data
+            static std::shared_ptr<Data> new_data(Arena* arena);
+            static std::shared_ptr<Data> empty_data();
+            // The Data, after taking a copy of it if it is shared, so that it
+            // can be changed
+            Data& mutate();
+            // Is this Table, or one of its sub-Tables, the given one?
+            bool contains(const Table* t) const;
+
+            // Find the Entry for a key (-1 if there is none)
+            long find(const KeyView key, const std::uint32_t hash,
+                    const Kind kind) const;
+            long find(const KeyView key, const Kind kind) const;
+            long find(const Symbol& key, const Kind kind) const;
+            long find(const StaticKey& key, const Kind kind) const;
+            // Add an Entry (the element itself must already be stored)
+            void insert(const KeyView key, const std::uint32_t hash,
+                    const Kind kind, const std::size_t slot);
+            // Raise a TableError unless an element of this kind can be added
+            // with the key
+            void check_new_key(const KeyView key, const std::uint32_t hash,
+                    const Kind kind) const;
+            // The Entries of one kind, sorted by key
+            std::vector<std::uint32_t> sorted(const Kind kind) const;
+            // Move the keys of this Table and its sub-Tables into another
+            // pool
+            void move_keys(const std::shared_ptr<KeyPool>& to);
+            // Replace the scalars and arrays of this Table with those of
+            // another (which has no sub-Tables), leaving the sub-Tables where
+            // they are
+            void replace_keys(Table&& from);
+
+            // The Arena holding this Table (nullptr for the heap)
+            Arena* arena() const;
+
+            friend class BindingBase;
+            friend class FrozenWriter;
+            friend class IncrementalParser;
 
         public:
             // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -247,16 +796,49 @@ namespace TOML {
             // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
             // Public functions
 
+            // Constructors
+            Table();
+            explicit Table(Arena& arena);
+            Table(const Table& t, Arena* arena);
+            // Copies share their contents until one of them is changed.
+            // Getting a non-const reference into a Table (get_scalar,
+            // get_array, get_table, or resolve on a non-const Table) counts
+            // as a change, so a copy that is only read should be read
+            // through a const reference.  References and Paths into a Table
+            // must not be used to change it once it has been copied (they
+            // would change the copies too), and Tables that share contents
+            // must not make the first read of the same lazy Value from
+            // different threads at the same time.
+            Table(const Table& t);
+            Table(Table&& t) noexcept;
+
+            // Assignment
+            Table& operator= (const Table& t);
+            Table& operator= (Table&& t) noexcept;
+
             // Parsing
-            void parse_string(const std::string s);
-            void parse_file(const std::string filename);
-            void parse_stream(std::istream& sin);
-            static bool valid_key(const std::string key);
+            void parse_string(const std::string s,
+                    const ParseOptions& options=ParseOptions());
+            void parse_file(const std::string filename,
+                    const ParseOptions& options=ParseOptions());
+            void parse_stream(std::istream& sin,
+                    const ParseOptions& options=ParseOptions());
+            void parse_buffer(const char* begin, const char* end,
+                    const ParseOptions& options=ParseOptions());
+            static bool valid_key(const std::string& key);
 
             // Add an element
-            void add(const std::string key, const Value& v);
-            void add(const std::string key, const ValueArray& va);
-            void add(const std::string key, const Table& t);
+            void add(const KeyView key, const Value& v);
+            void add(const KeyView key, const ValueArray& va);
+            void add(const KeyView key, const Table& t);
+            // These take over the element instead of copying it (unless it
+            // has to be copied into this Table's Arena)
+            void add(const KeyView key, Value&& v);
+            void add(const KeyView key, ValueArray&& va);
+            void add(const KeyView key, Table&& t);
+            // Add an empty ValueArray or Table, to be filled in place
+            ValueArray& add_array(const KeyView key);
+            Table& add_table(const KeyView key);
 
             // Get the list of keys
             std::vector<std::string> all_keys() const;
@@ -264,27 +846,67 @@ namespace TOML {
             std::vector<std::string> array_keys() const;
             std::vector<std::string> table_keys() const;
 
+            // Look a key up in the Table's KeyPool once, so that it can then
+            // be found by id (in this Table and every Table sharing its pool)
+            Symbol symbol(const KeyView key);
+            // The KeyPool of the Table (nullptr if it has no keys yet)
+            std::shared_ptr<const KeyPool> key_pool() const;
+
             // Does the key exist in the table?
-            bool has(const std::string key) const;
+            bool has(const KeyView key) const;
+            bool has(const Symbol& key) const;
+            bool has(const StaticKey& key) const;
             // This form allows you to specify a path (vector of keys to follow
             // in order to dive into nested tables), instead of having to
             // manually work through all path elements one at a time.
-            bool has(const std::vector<std::string> path) const;
-            bool has_scalar(const std::string key) const;
-            bool has_array(const std::string key) const;
-            bool has_table(const std::string key) const;
+            bool has(const std::vector<std::string>& path) const;
+            bool has_scalar(const KeyView key) const;
+            bool has_array(const KeyView key) const;
+            bool has_table(const KeyView key) const;
+            bool has_scalar(const Symbol& key) const;
+            bool has_array(const Symbol& key) const;
+            bool has_table(const Symbol& key) const;
+            bool has_scalar(const StaticKey& key) const;
+            bool has_array(const StaticKey& key) const;
+            bool has_table(const StaticKey& key) const;
 
             // Access an element by its key
-            Value& get_scalar(const std::string key);
-            ValueArray& get_array(const std::string key);
-            Table& get_table(const std::string key);
-            const Table& get_table(const std::string key) const;
+            Value& get_scalar(const KeyView key);
+            const Value& get_scalar(const KeyView key) const;
+            ValueArray& get_array(const KeyView key);
+            const ValueArray& get_array(const KeyView key) const;
+            Table& get_table(const KeyView key);
+            const Table& get_table(const KeyView key) const;
+            Value& get_scalar(const Symbol& key);
+            const Value& get_scalar(const Symbol& key) const;
+            ValueArray& get_array(const Symbol& key);
+            const ValueArray& get_array(const Symbol& key) const;
+            Table& get_table(const Symbol& key);
+            const Table& get_table(const Symbol& key) const;
+            Value& get_scalar(const StaticKey& key);
+            const Value& get_scalar(const StaticKey& key) const;
+            ValueArray& get_array(const StaticKey& key);
+            const ValueArray& get_array(const StaticKey& key) const;
+            Table& get_table(const StaticKey& key);
+            const Table& get_table(const StaticKey& key) const;
             // This form allows you to specify a path (vector of keys to follow
             // in order to dive into nested tables), instead of having to
             // manually work through all path elements one at a time.
-            Table& get_table(const std::vector<std::string> path,
+            Table& get_table(const std::vector<std::string>& path,
                     const bool create=false);
-            const Table& get_table(const std::vector<std::string> path) const;
+            const Table& get_table(const std::vector<std::string>& path)
+                const;
+
+            // Find an element from a dotted path ("experiment.step_small")
+            // once, to be read through the handle afterwards.  The keys may
+            // be bare or quoted, as in a Table header.  If the last key names
+            // more than one kind of element, a scalar is preferred to an
+            // array and an array to a Table.
+            Path resolve(const KeyView path);
+
+            // Pack the whole Table into a read-only FrozenTable (reading
+            // every Value, so lazy Values are decoded first)
+            FrozenTable freeze() const;
 
             // Clear the Table
             void clear();
@@ -295,6 +917,603 @@ namespace TOML {
                     std::ostream& sout, const Table& g);
     };
 
+    // ========================================================================
+
+    // How a frozen Table is laid out in its buffer (internal).  Everything is
+    // found by its offset from the start of the buffer, so the buffer can be
+    // moved as it is.  Each Table is a Record followed by its Entries
+    // (sorted by key) and then its hash index; each array is an Array
+    // followed by its Scalars.  The characters of each key are stored once.
+    struct FrozenLayout {
+        // The start of the buffer
+        struct Header {
+            char magic[8];
+            std::uint32_t bytes;  // The size of the whole buffer
+            std::uint32_t root;   // The Record of the root Table
+        };
+
+        // A single Value, decoded (EMPTY for a Value that was never set).  A
+        // Float that is a whole number stays a FLOAT and is read as an
+        // Integer too, as with a Value.
+        enum Type { EMPTY, STRING, INTEGER, FLOAT, BOOLEAN };
+        struct Scalar {
+            std::uint32_t type;
+            std::uint32_t size;  // Of a STRING
+            union {
+                Integer integer;
+                Float floating;
+                Boolean boolean;
+                std::uint32_t text;  // The characters of a STRING
+            } value;
+        };
+
+        // The formats an Array is conformable to (as in ValueArray)
+        enum { TO_STRING = 1, TO_INTEGER = 2, TO_FLOAT = 4, TO_BOOLEAN = 8 };
+        struct Array {
+            std::uint32_t size;
+            std::uint32_t conformable;
+        };
+
+        // The same kinds of element, hashes, and hash index as in a Table
+        enum Kind { SCALAR, ARRAY, TABLE, ANY };
+        struct Entry {
+            std::uint32_t key;
+            std::uint32_t size;
+            std::uint32_t hash;
+            std::uint32_t kind;
+            std::uint32_t element;
+        };
+        struct Bucket {
+            std::uint32_t hash;
+            std::uint32_t entry;
+        };
+        struct Record {
+            std::uint32_t size;
+            std::uint32_t buckets;
+        };
+    };
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+    // A scalar of a FrozenTable, read the same way as a Value
+    class FrozenValue {
+        private:
+            const char* base;
+            const FrozenLayout::Scalar* scalar;
+
+            friend class FrozenArray;
+            friend class FrozenTable;
+            FrozenValue(const char* base, const FrozenLayout::Scalar* scalar):
+                base(base), scalar(scalar) {}
+
+        public:
+            // Getters
+            String as_string() const;
+            Integer as_integer() const;
+            Float as_float() const;
+            Boolean as_boolean() const;
+
+            // Type
+            bool is_valid_string() const;
+            bool is_valid_integer() const;
+            bool is_valid_float() const;
+            bool is_valid_boolean() const;
+
+            // Output
+            std::string serialize() const;
+            friend std::ostream& operator<< (
+                    std::ostream& sout, const FrozenValue& v);
+    };
+
+    std::ostream& operator<< (std::ostream& sout, const FrozenValue& v);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+    // An array of a FrozenTable, read the same way as a ValueArray
+    class FrozenArray {
+        private:
+            const char* base;
+            const FrozenLayout::Array* array;
+
+            friend class FrozenTable;
+            FrozenArray(const char* base, const FrozenLayout::Array* array):
+                base(base), array(array) {}
+
+            const FrozenLayout::Scalar* elements() const;
+
+        public:
+            // Size of the array
+            unsigned size() const;
+
+            // Access an element
+            FrozenValue at(const unsigned index) const;
+
+            // Convert to vector of a specific type
+            std::vector<String> as_string() const;
+            std::vector<Integer> as_integer() const;
+            std::vector<Float> as_float() const;
+            std::vector<Boolean> as_boolean() const;
+
+            // Output
+            std::string serialize() const;
+            friend std::ostream& operator<< (
+                    std::ostream& sout, const FrozenArray& va);
+    };
+
+    std::ostream& operator<< (std::ostream& sout, const FrozenArray& va);
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+    // A Table that can no longer be changed (made with Table::freeze).  All
+    // of its keys, Values, arrays, and sub-Tables are packed into one buffer
+    // with no pointers in it, and it is read with the same functions as a
+    // Table (scalars and arrays come back as FrozenValues and FrozenArrays).
+    // Nothing is ever written after it is made, so any number of threads can
+    // read it at the same time.
+    //     The FrozenTable returned by freeze() owns the buffer, and so do its
+    // copies (which share it).  The FrozenTables, FrozenValues, and
+    // FrozenArrays read from it only point into the buffer, so they are only
+    // valid while one of those is alive.
+    class FrozenTable {
+        private:
+            std::shared_ptr<const char> storage;  // Empty unless it owns
+            const char* base;
+            const FrozenLayout::Record* record;
+
+            friend class FrozenWriter;
+            FrozenTable(const char* base, const std::uint32_t record);
+
+            const FrozenLayout::Entry* entries() const;
+
+            // Find the Entry for a key (nullptr if there is none)
+            const FrozenLayout::Entry* find(const KeyView key,
+                    const std::uint32_t hash,
+                    const FrozenLayout::Kind kind) const;
+            const FrozenLayout::Entry* find(const KeyView key,
+                    const FrozenLayout::Kind kind) const;
+            const FrozenLayout::Entry* find(const StaticKey& key,
+                    const FrozenLayout::Kind kind) const;
+            // The element of an Entry, or a TableError if it is missing
+            FrozenValue scalar(const FrozenLayout::Entry* e,
+                    const KeyView key) const;
+            FrozenArray array(const FrozenLayout::Entry* e,
+                    const KeyView key) const;
+            FrozenTable table(const FrozenLayout::Entry* e,
+                    const KeyView key) const;
+            std::vector<std::string> keys(const FrozenLayout::Kind kind)
+                const;
+
+        public:
+            // An empty FrozenTable
+            FrozenTable();
+
+            // The size of the whole buffer, in bytes
+            std::size_t bytes() const;
+
+            // Get the list of keys
+            std::vector<std::string> all_keys() const;
+            std::vector<std::string> scalar_keys() const;
+            std::vector<std::string> array_keys() const;
+            std::vector<std::string> table_keys() const;
+
+            // Does the key exist in the table?
+            bool has(const KeyView key) const;
+            bool has(const StaticKey& key) const;
+            bool has(const std::vector<std::string>& path) const;
+            bool has_scalar(const KeyView key) const;
+            bool has_array(const KeyView key) const;
+            bool has_table(const KeyView key) const;
+            bool has_scalar(const StaticKey& key) const;
+            bool has_array(const StaticKey& key) const;
+            bool has_table(const StaticKey& key) const;
+
+            // Access an element by its key
+            FrozenValue get_scalar(const KeyView key) const;
+            FrozenArray get_array(const KeyView key) const;
+            FrozenTable get_table(const KeyView key) const;
+            FrozenValue get_scalar(const StaticKey& key) const;
+            FrozenArray get_array(const StaticKey& key) const;
+            FrozenTable get_table(const StaticKey& key) const;
+            FrozenTable get_table(const std::vector<std::string>& path) const;
+
+            // Output (the same as for the Table it was made from)
+            std::string serialize(unsigned indent_level=0) const;
+            friend std::ostream& operator<< (
+                    std::ostream& sout, const FrozenTable& t);
+    };
+
+    std::ostream& operator<< (std::ostream& sout, const FrozenTable& t);
+
+    // ========================================================================
+
+    // A document can also be read as a series of events, without building a
+    // Table: derive from Handler, override the events of interest (they do
+    // nothing by default), and pass it to one of the parse functions below.
+    // The grammar is the same one Tables are read with -- Tables are in fact
+    // built by a Handler -- and the same ParseErrors are raised.  A Handler
+    // may raise its own exceptions to stop the parse.
+    class Handler {
+        public:
+            virtual ~Handler() {}
+
+            // A Table header, as the path of keys from the root Table
+            virtual void on_table_header(
+                    const std::vector<std::string>& /* path */) {}
+            // A key whose value is a single Value
+            virtual void on_key_value(const std::string& /* key */,
+                    const Value& /* value */) {}
+            // A key whose value is an array: on_array_begin, then each
+            // element in order, then on_array_end
+            virtual void on_array_begin(const std::string& /* key */) {}
+            virtual void on_array_element(const Value& /* value */) {}
+            virtual void on_array_end() {}
+
+            // The parser actually sends its Values as temporaries, to these
+            // two, which pass them on to the two above.  Override them to
+            // take a Value over without copying it.
+            virtual void on_key_value(const std::string& key, Value&& value)
+                { on_key_value(key, static_cast<const Value&>(value)); }
+            virtual void on_array_element(Value&& value)
+                { on_array_element(static_cast<const Value&>(value)); }
+    };
+
+    // Parse a document, sending its events to the Handler
+    void parse_string(const std::string s, Handler& handler,
+            const ParseOptions& options=ParseOptions());
+    void parse_file(const std::string filename, Handler& handler,
+            const ParseOptions& options=ParseOptions());
+    void parse_stream(std::istream& sin, Handler& handler,
+            const ParseOptions& options=ParseOptions());
+    void parse_buffer(const char* begin, const char* end, Handler& handler,
+            const ParseOptions& options=ParseOptions());
+
+    // ========================================================================
+
+    // Parses a document that arrives in pieces (e.g. from a pipe): feed()
+    // each chunk as it comes, however it happens to be split, then call
+    // finish() at the end of the input.  Every complete line is parsed as
+    // soon as it has been fed, so parsing keeps pace with the input; only the
+    // unfinished last line (which may end in the middle of a key, String,
+    // number, or array) is held back until the rest of it arrives.  Events go
+    // to a Handler, or into a Table (which is cleared first, and cleared again
+    // if a ParseError is raised).  After finish() or a ParseError the parser
+    // must not be fed again.
+    class PushParser {
+        private:
+            Handler* handler;
+            std::unique_ptr<Handler> builder;  // Only to fill a Table
+            Table* table;
+            ParseOptions options;
+            std::string pending;  // The start of the unfinished line
+
+            void parse(const char* begin, const char* end, const bool last);
+
+        public:
+            explicit PushParser(Handler& handler,
+                    const ParseOptions& options=ParseOptions());
+            explicit PushParser(Table& table,
+                    const ParseOptions& options=ParseOptions());
+            PushParser(const PushParser&) = delete;
+            PushParser& operator=(const PushParser&) = delete;
+
+            // Parse the next chunk of the document
+            void feed(const char* data, const std::size_t size);
+
+            // Parse what is left (a last line without a newline)
+            void finish();
+    };
+
+    // ========================================================================
+
+    // Keeps a Table in step with a document that is edited and read again.
+    // Each version is split into sections (the lines from one Table header up
+    // to the next, as for a parallel parse), and the byte range and a hash of
+    // each section are kept.  When the next version has the same sections,
+    // only those whose bytes changed are parsed, and their keys replace the
+    // old ones in place: the Tables of the other sections are left alone (the
+    // same objects, at the same addresses, with the same Values), and so are
+    // the sub-Tables of a changed one.  If sections were added or removed, a
+    // changed section names a different Table or fails to parse, or a new key
+    // clashes with a sub-Table, the whole document is parsed instead.  Either
+    // way the Table ends up as a full parse would leave it, and a ParseError
+    // is the one a full parse raises, except that it leaves the Table as it
+    // was.  A Table in an Arena is always parsed on one thread.
+    class IncrementalParser {
+        private:
+            struct SectionRecord {
+                std::size_t offset;
+                std::size_t size;
+                std::uint64_t hash;
+                std::vector<std::string> path;  // Empty with no header
+            };
+
+            Table& table;
+            ParseOptions options;
+            std::vector<SectionRecord> sections;
+            std::vector<std::string> changed_sections;
+            bool was_incremental;
+
+            void full_parse(const char* begin, const char* end);
+
+        public:
+            explicit IncrementalParser(Table& table,
+                    const ParseOptions& options=ParseOptions());
+            IncrementalParser(const IncrementalParser&) = delete;
+            IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+            // Bring the Table up to date with the next version (the first
+            // version is always parsed in full)
+            void parse_string(const std::string s);
+            void parse_file(const std::string filename);
+            void parse_buffer(const char* begin, const char* end);
+
+            // The sections that the last version changed, by the dotted path
+            // of their header ("" for the keys before the first header); all
+            // of them after a full parse
+            const std::vector<std::string>& changed() const;
+            // Was the last version parsed one section at a time?
+            bool incremental() const;
+    };
+
+    // ========================================================================
+
+    // The result of parsing one file of a batch: the Table, or the error that
+    // stopped it (the Table is then cleared, as for a ParseError).
+    struct ParsedFile {
+        std::string filename;
+        Table table;
+        std::exception_ptr error;
+
+        // Was the file parsed?
+        bool ok() const;
+        // The message of the error ("" if there was none)
+        std::string message() const;
+    };
+
+    // Parse many files at once, on a pool of threads (0 means one per hardware
+    // thread).  Each thread starts with its own share of the files and, when
+    // it runs out, takes half of what is left of another thread's share, so
+    // a few large files do not hold up the rest.  The results are in the
+    // order of the file names.  An error in one file (including a file that
+    // cannot be opened) is kept in its result and the others are still
+    // parsed.
+    std::vector<ParsedFile> parse_files(
+            const std::vector<std::string>& filenames,
+            const unsigned threads=0,
+            const ParseOptions& options=ParseOptions());
+
+    // ========================================================================
+
+    // A configuration that can be read again (e.g. on SIGHUP) while other
+    // threads are reading it.  Each version of the file is parsed into a
+    // Table of its own, away from the readers, and frozen; the FrozenTable is
+    // then published in a single atomic step.  Readers take a Snapshot of
+    // the current version with read(), which never waits (it is a counter
+    // increment and a pointer load) and never sees a half-built Table.  A
+    // version that is replaced is only freed once every Snapshot that might
+    // point at it is gone (RCU-style: reload() waits for them).  If a reload
+    // fails the error is raised and the old version stays in place.
+    //     Snapshots are meant to be short-lived, as they hold up reload().
+    // To keep a version for longer, copy its FrozenTable (the copy shares
+    // the buffer, and keeps it alive by itself).
+    class ConfigHandle {
+        private:
+            // The readers, counted by the parity of the generation they
+            // started in, spread over stripes that are each aligned to (and
+            // fill) a 64-byte cache line, so that threads on different
+            // stripes do not contend for one line.  (A ConfigHandle on the
+            // heap is only given that alignment by new from C++17 on.)
+            struct alignas(64) Stripe {
+                std::atomic<long> readers[2];
+            };
+            static const unsigned stripe_count = 16;
+
+            std::string filename;
+            ParseOptions options;
+            std::atomic<const FrozenTable*> current;
+            std::atomic<unsigned> generation;
+            Stripe stripes[stripe_count];
+            std::atomic<unsigned long> version_count;
+            std::mutex writer;  // One reload or publish at a time
+
+            // Wait until every reader that might still see the replaced
+            // version has finished
+            void synchronize();
+
+            ConfigHandle(const ConfigHandle&);
+            ConfigHandle& operator= (const ConfigHandle&);
+
+        public:
+            // A reader's hold on one version
+            class Snapshot {
+                private:
+                    std::atomic<long>* readers;
+                    const FrozenTable* table;
+
+                    friend class ConfigHandle;
+                    Snapshot(std::atomic<long>* readers,
+                            const FrozenTable* table):
+                        readers(readers), table(table) {}
+
+                    Snapshot(const Snapshot&);
+                    Snapshot& operator= (const Snapshot&);
+
+                public:
+                    Snapshot(Snapshot&& s) noexcept:
+                        readers(s.readers), table(s.table)
+                    {
+                        s.readers = nullptr;
+                    }
+                    ~Snapshot() {
+                        if (readers != nullptr) {
+                            readers->fetch_sub(1);
+                        }
+                    }
+
+                    const FrozenTable& operator* () const { return *table; }
+                    const FrozenTable* operator-> () const { return table; }
+            };
+
+            // Parse the file for the first version (raising any error, as
+            // parse_file does)
+            explicit ConfigHandle(const std::string filename,
+                    const ParseOptions& options=ParseOptions());
+            // No Snapshot may outlive the handle
+            ~ConfigHandle();
+
+            // The current version
+            Snapshot read();
+
+            // Parse the file again and publish it
+            void reload();
+            // Publish a Table that was built some other way
+            void publish(const Table& table);
+
+            // The number of versions published (starting from 1)
+            unsigned long version() const;
+    };
+
+    // ========================================================================
+
+    // Read a file into a FrozenTable through a binary cache kept next to it
+    // (the file name with ".bin" added).  The cache holds the FrozenTable's
+    // buffer as it is, with the size, modification time, and a hash of the
+    // contents of the file it was made from.  The size and modification
+    // time are checked first, so a stale cache is turned down without
+    // reading the file; a cache that passes is then checked against a hash
+    // of the contents, which reads the whole file (linear in its size, but
+    // much cheaper than parsing it).  When all three match, the cache is
+    // memory-mapped and read in place, with nothing to parse and nothing
+    // allocated per key; otherwise the file is parsed and frozen, and the
+    // cache is written again (through a temporary file that is then renamed,
+    // so that processes reading it at the same time see either the old cache
+    // or the new one).  A cache that cannot be written is simply not used.
+    // The cache is only meant for the machine that wrote it, and is trusted
+    // once its header matches.
+    FrozenTable parse_file_cached(const std::string filename,
+            const ParseOptions& options=ParseOptions());
+
+    // ========================================================================
+
+    // The part of a Binding that does not depend on the struct: which scalars
+    // are bound, with what type, and finding them in a Table.
+    class BindingBase {
+        protected:
+            enum Type { STRING, INTEGER, FLOAT, BOOLEAN };
+
+            // A bound scalar: its dotted path, the path of the Table it is in,
+            // and its key (hashed once, when it is bound)
+            struct Field {
+                std::string name;
+                std::vector<std::string> table;
+                std::string key;
+                std::uint32_t hash;
+                Type type;
+            };
+
+            // The Fields in the order they were bound, and the order to look
+            // them up in (grouped by Table, so that each Table is only found
+            // once)
+            std::vector<Field> fields;
+            std::vector<std::size_t> order;
+
+            void add_field(const KeyView path, const Type type);
+
+            // Find the Value of every Field (in the order they were bound),
+            // or raise a BindingError listing every Field that is missing or
+            // cannot be read as its type
+            void find_values(const Table& table,
+                    std::vector<const Value*>& values) const;
+    };
+
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+    // Fills in the members of a struct from the scalars of a Table.  Declare
+    // once which dotted path goes to which member:
+    //     TOML::Binding<Config> binding;
+    //     binding.bind("field.wave_speed", &Config::wave_speed)
+    //            .bind("experiment.name", &Config::name);
+    // then extract() as many Tables as needed.  The type read is the type of
+    // the member.  Each Table on the way is looked up once for all of its
+    // keys, and if anything is missing or of the wrong type a BindingError
+    // lists all of it, with the struct left unchanged.
+    template <class T>
+    class Binding : private BindingBase {
+        private:
+            // The member of each Field (which one is set depends on its Type)
+            union Member {
+                String T::* string_member;
+                Integer T::* integer_member;
+                Float T::* float_member;
+                Boolean T::* boolean_member;
+            };
+            std::vector<Member> members;
+
+        public:
+            // Bind a dotted path (keys bare or quoted) to a member
+            Binding& bind(const KeyView path, String T::* member) {
+                add_field(path, STRING);
+                Member m;
+                m.string_member = member;
+                members.push_back(m);
+                return *this;
+            }
+            Binding& bind(const KeyView path, Integer T::* member) {
+                add_field(path, INTEGER);
+                Member m;
+                m.integer_member = member;
+                members.push_back(m);
+                return *this;
+            }
+            Binding& bind(const KeyView path, Float T::* member) {
+                add_field(path, FLOAT);
+                Member m;
+                m.float_member = member;
+                members.push_back(m);
+                return *this;
+            }
+            Binding& bind(const KeyView path, Boolean T::* member) {
+                add_field(path, BOOLEAN);
+                Member m;
+                m.boolean_member = member;
+                members.push_back(m);
+                return *this;
+            }
+
+            // Fill in the bound members of an object
+            void extract(const Table& table, T& object) const {
+                std::vector<const Value*> values;
+                find_values(table, values);
+                for (std::size_t index = 0; index < fields.size(); index++) {
+                    const Member& m = members[index];
+                    switch (fields[index].type) {
+                        case STRING:
+                            object.*m.string_member =
+                                values[index]->as_string();
+                            break;
+                        case INTEGER:
+                            object.*m.integer_member =
+                                values[index]->as_integer();
+                            break;
+                        case FLOAT:
+                            object.*m.float_member =
+                                values[index]->as_float();
+                            break;
+                        case BOOLEAN:
+                            object.*m.boolean_member =
+                                values[index]->as_boolean();
+                            break;
+                    }
+                }
+            }
+
+            T extract(const Table& table) const {
+                T object;
+                extract(table, object);
+                return object;
+            }
+    };
+
 }
 
 #endif // #ifndef TOML_H